@@ -2,31 +2,70 @@
 
 #include <algorithm>
 #include <ranges>
-#include <unordered_set>
-#include <vector>
-#include <deque>
+#include <numeric>
 #include <span>
+#include <vector>
 
 #include "common.h"
 
 namespace algo
 {
 
-    class Algo
+    // 并查集，按大小合并并做路径压缩，单次操作均摊近似 O(1)
+    class DisjointSet
     {
     public:
-        using Indexes = std::unordered_set<size_t>;
-        using IndexesGroup = std::vector<Indexes>;
+        explicit DisjointSet(size_t size) : m_parent(size), m_size(size, 1)
+        {
+            std::iota(m_parent.begin(), m_parent.end(), size_t(0));
+        }
 
-        using RectContext = std::tuple<size_t, _Rect<float>, float>;
+        size_t find(size_t i)
+        {
+            while (m_parent[i] != i)
+            {
+                // path halving
+                m_parent[i] = m_parent[m_parent[i]];
+                i = m_parent[i];
+            }
+            return i;
+        }
 
-        static void _report_pair(size_t i, size_t j, IndexesGroup &index_groups)
+        // 返回 i 和 j 原本是否属于不同的集合
+        bool unite(size_t i, size_t j)
         {
-            index_groups[i].insert(j);
-            index_groups[j].insert(i);
+            i = find(i);
+            j = find(j);
+            if (i == j)
+            {
+                return false;
+            }
+            if (m_size[i] < m_size[j])
+            {
+                std::swap(i, j);
+            }
+            m_parent[j] = i;
+            m_size[i] += m_size[j];
+            return true;
         }
 
-        static void _stab(std::vector<RectContext> &S1, std::vector<RectContext> &S2, IndexesGroup &index_groups)
+        size_t size() const
+        {
+            return m_parent.size();
+        }
+
+    private:
+        std::vector<size_t> m_parent;
+        std::vector<size_t> m_size;
+    };
+
+    class Algo
+    {
+    public:
+        using RectContext = std::tuple<size_t, _Rect<float>, float>;
+
+        template <typename Report>
+        static void _stab(std::span<const RectContext> V, std::span<const size_t> S1, std::span<const size_t> S2, Report &report)
         {
             // '''Check interval intersection in y-direction.
 
@@ -46,46 +85,38 @@ namespace algo
             //             k := k + 1
             //         j := j + 1
             // '''
-            if (S1.empty() || S2.empty())
-            {
-                return;
-            }
-
-            // sort
-            std::ranges::sort(S1, [](const RectContext &lhs, const RectContext &rhs)
-                               { return std::get<1>(lhs)[1] < std::get<1>(rhs)[1]; });
-            std::ranges::sort(S2, [](const RectContext &lhs, const RectContext &rhs)
-                               { return std::get<1>(lhs)[1] < std::get<1>(rhs)[1]; });
+            // S1 和 S2 是 V 的下标，已经按 y0 排好序；y 方向按闭区间判断，只有一个点重合也算相交
+            const auto rect = [&](size_t e) -> const _Rect<float> &
+            { return std::get<1>(V[e]); };
+            const auto index = [&](size_t e)
+            { return std::get<0>(V[e]) / 2; };
 
             size_t i = 0, j = 0;
             while (i < S1.size() && j < S2.size())
             {
-                const auto &[m, a, _] = S1[i];
-                const auto &[n, b, _] = S2[j];
-                if (a[1] < b[1])
+                const auto &a = rect(S1[i]);
+                const auto &b = rect(S2[j]);
+                if (a.y0 <= b.y0)
                 {
-                    size_t k = j;
-                    while (k < S2.size() && std::get<1>(S2[k])[1] < a[3])
+                    for (size_t k = j; k < S2.size() && rect(S2[k]).y0 <= a.y1; ++k)
                     {
-                        _report_pair(int(m / 2), int(std::get<0>(S2[k]) / 2), index_groups);
-                        k += 1;
+                        report(index(S1[i]), index(S2[k]));
                     }
                     i += 1;
                 }
                 else
                 {
-                    size_t k = i;
-                    while (k < S1.size() && std::get<1>(S1[k])[1] < b[3])
+                    for (size_t k = i; k < S1.size() && rect(S1[k]).y0 <= b.y1; ++k)
                     {
-                        _report_pair(int(std::get<0>(S1[k]) / 2), int(n / 2), index_groups);
-                        k += 1;
+                        report(index(S1[k]), index(S2[j]));
                     }
                     j += 1;
                 }
             }
         }
 
-        static void solve_rects_intersection(const std::span<RectContext> &V, size_t num, IndexesGroup &index_groups)
+        template <typename Report>
+        static void solve_rects_intersection(std::span<const RectContext> V, Report &&report)
         {
             // '''Implementation of solving Rectangle-Intersection Problem.
 
@@ -94,9 +125,9 @@ namespace algo
             //     O(nlog n + k) time and O(n) space, where k is the count of intersection pairs.
 
             // Args:
-            //     V (list): Rectangle-related x-edges data, [(index, Rect, x), (...), ...].
-            //     num (int): Count of V instances, equal to len(V).
-            //     index_groups (list): Target adjacent list for connectivity between rects.
+            //     V (list): Rectangle-related x-edges data sorted by x, [(index, Rect, x), (...), ...].
+            //         Rect k has edges 2k (x0) and 2k + 1 (x1); on equal x the x0 edges must come first.
+            //     report (callable): Called with the two rect indexes of every intersecting pair.
 
             // Procedure ``detect(V, H, m)``::
 
@@ -109,50 +140,87 @@ namespace algo
             //     - stab(S12, S22); stab(S21, S11); stab(S12, S21)
             //     - detect(V1, H1, ⌊m/2⌋); detect(V2, H2, m − ⌊m/2⌋)
             // '''
+            // 整个递归只分配一次：order 是 V 的下标排列，递归返回时每一段都已按 y0 归并排好序，
+            // 上层按顺序筛选出 S11/S12/S21/S22 即可，不再逐层排序；scratch 存放筛选和归并的中间结果
+            // position 记录每条边在 V 中的位置，S 集合按边的位置而不是 x 坐标划分，
+            // 相同 x 的边不论落在哪一半都不会漏报：x 方向也是闭区间，只有一条边重合的矩形也算相交
+            std::vector<size_t> buffer(4 * V.size());
+            const auto order = std::span(buffer).first(V.size());
+            const auto position = std::span(buffer).subspan(V.size(), V.size());
+            const auto scratch = std::span(buffer).subspan(2 * V.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                order[i] = i;
+                position[std::get<0>(V[i])] = i;
+            }
+            _detect(V, 0, V.size(), order, position, scratch, report);
+        }
+
+        template <typename Report>
+        static void _detect(std::span<const RectContext> V, size_t begin, size_t end, std::span<size_t> order, std::span<const size_t> position, std::span<size_t> scratch, Report &report)
+        {
+            const auto num = end - begin;
             if (num < 2)
             {
                 return;
             }
 
-            // start/end points of left/right intervals
-            const auto center_pos = num / 2;
-            const auto X0 = std::get<2>(V.front());
-            const auto X = std::get<2>(V[center_pos - 1]);
-            const auto X1 = std::get<2>(V.back());
-
-            // split into two groups
-            auto left = V.subspan(0, center_pos);
-            auto right = V.subspan(center_pos, num - center_pos);
-
-            // filter rects according to their position to each intervals
-            auto S11 = std::ranges::filter_view(left, [&](const auto &item)
-                                                { return std::get<2>(item) <= X; }) |
-                       std::ranges::to<std::vector>();
-            auto S12 = std::ranges::filter_view(left, [&](const auto &item)
-                                                { return std::get<2>(item) >= X1; }) |
-                       std::ranges::to<std::vector>();
-            auto S22 = std::ranges::filter_view(right, [&](const auto &item)
-                                                { return std::get<2>(item) > X; }) |
-                       std::ranges::to<std::vector>();
-            auto S21 = std::ranges::filter_view(right, [&](const auto &item)
-                                                { return std::get<2>(item) <= X0; }) |
-                       std::ranges::to<std::vector>();
+            // V1 = [begin, center), V2 = [center, end)
+            const auto center = begin + num / 2;
+
+            // recursive process, both halves come back sorted by y0
+            _detect(V, begin, center, order, position, scratch, report);
+            _detect(V, center, end, order, position, scratch, report);
+
+            const auto left = order.subspan(begin, center - begin);
+            const auto right = order.subspan(center, end - center);
+            const auto rect = [&](size_t e) -> const _Rect<float> &
+            { return std::get<1>(V[e]); };
+            const auto is_x1 = [&](size_t e)
+            { return (std::get<0>(V[e]) & 1) != 0; };
+            const auto partner = [&](size_t e)
+            { return position[std::get<0>(V[e]) ^ 1]; };
+
+            // filter rects according to the position of their edges, keeping the y0 order;
+            // every rect is taken through one of its edges only, so none appears twice in a set
+            const auto filter = [&](std::span<const size_t> from, std::span<size_t> to, auto &&pred)
+            {
+                size_t n = 0;
+                for (const auto e : from)
+                {
+                    if (pred(e))
+                    {
+                        to[n++] = e;
+                    }
+                }
+                return std::span<const size_t>(to.first(n));
+            };
+            // S11: x1 in V1; S12: x0 in V1 and x1 after V2; S22: x0 in V2; S21: x1 in V2 and x0 before V1
+            const auto S11 = filter(left, scratch.subspan(0, left.size()), [&](size_t e)
+                                    { return is_x1(e); });
+            const auto S12 = filter(left, scratch.subspan(left.size(), left.size()), [&](size_t e)
+                                    { return !is_x1(e) && partner(e) >= end; });
+            const auto S22 = filter(right, scratch.subspan(2 * left.size(), right.size()), [&](size_t e)
+                                    { return !is_x1(e); });
+            const auto S21 = filter(right, scratch.subspan(2 * left.size() + right.size(), right.size()), [&](size_t e)
+                                    { return is_x1(e) && partner(e) < begin; });
 
             // intersection in x-direction is fulfilled, so check y-direction further
-            _stab(S12, S22, index_groups);
-            _stab(S21, S11, index_groups);
-            _stab(S12, S21, index_groups);
-
-            // recursive process
-            solve_rects_intersection(left, center_pos, index_groups);
-            solve_rects_intersection(right, num - center_pos, index_groups);
+            _stab(V, S12, S22, report);
+            _stab(V, S21, S11, report);
+            _stab(V, S12, S21, report);
+
+            // merge both halves by y0 for the caller
+            const auto merged = scratch.first(num);
+            std::ranges::merge(left, right, merged.begin(), {}, [&](size_t e)
+                               { return rect(e).y0; }, [&](size_t e)
+                               { return rect(e).y0; });
+            std::ranges::copy(merged, left.begin());
         }
 
         static std::vector<_Rects<float>> group_by_connectivity(const _Rects<float> &segs, float dx = 0, float dy = 0)
         {
             const auto size = segs.size();
-            IndexesGroup index_groups;
-            index_groups.reserve(size);
 
             std::vector<std::tuple<size_t, _Rect<float>, float>> i_rect_x;
             i_rect_x.reserve(size * 2);
@@ -164,96 +232,37 @@ namespace algo
             for (const auto &seg : segs)
             {
                 _Rect<float> points = {seg.x0 + d_rect.x0, seg.y0 + d_rect.y0, seg.x1 + d_rect.x1, seg.y1 + d_rect.y1};
-                i_rect_x.push_back(std::make_tuple(i, points, seg.x0));
-                i_rect_x.push_back(std::make_tuple(i + 1, points, seg.x1));
+                i_rect_x.push_back(std::make_tuple(i, points, points.x0));
+                i_rect_x.push_back(std::make_tuple(i + 1, points, points.x1));
 
                 i += 2;
             }
 
-            std::ranges::sort(i_rect_x, [&](const auto &lhs, const auto &rhs)
-                              { return std::get<2>(lhs) < std::get<2>(rhs); });
-
-            solve_rects_intersection(i_rect_x, 2 * size, index_groups);
+            // x 相同时左边在前，首尾相接的线段也算连通
+            std::ranges::sort(i_rect_x, {}, [](const auto &e)
+                              { return std::pair(std::get<2>(e), std::get<0>(e) & 1); });
 
-            const auto groups = graph_bfs(index_groups);
+            // 求交的同时合并连通分量，不保存邻接表
+            DisjointSet components(size);
+            solve_rects_intersection(i_rect_x, [&](size_t i, size_t j)
+                                     { components.unite(i, j); });
 
+            // 分组按最小下标排序，组内下标升序
             std::vector<_Rects<float>> rects_groups;
-
-            for (const auto &group : groups)
+            std::vector<size_t> group_of(size, size);
+            for (size_t index = 0; index < size; ++index)
             {
-                auto &rects = rects_groups.emplace_back();
-                for (const auto &index : group)
+                auto &group = group_of[components.find(index)];
+                if (group == size)
                 {
-                    rects.push_back(segs[index]);
+                    group = rects_groups.size();
+                    rects_groups.emplace_back();
                 }
+                rects_groups[group].push_back(segs[index]);
             }
 
             return rects_groups;
         }
-
-        static IndexesGroup graph_bfs(const IndexesGroup &graph)
-        {
-            // '''Breadth First Search graph (may be disconnected graph).
-
-            // Args:
-            //     graph (list): GRAPH represented by adjacent list, [set(1,2,3), set(...), ...]
-
-            // Returns:
-            //     list: A list of connected components
-            // '''
-            // search graph
-            // NOTE: generally a disconnected graph
-            std::unordered_set<size_t> counted_indexes;
-            IndexesGroup groups;
-            for (size_t i = 0; i < graph.size(); ++i)
-            {
-                if (counted_indexes.find(i) != counted_indexes.end())
-                {
-                    continue;
-                }
-
-                // connected component starts...
-                auto indexes = _graph_bfs_from_node(graph, i);
-                groups.push_back(indexes);
-                counted_indexes.insert(indexes.begin(), indexes.end());
-            }
-
-            return groups;
-        }
-
-        static Indexes _graph_bfs_from_node(const IndexesGroup &graph, size_t start)
-        {
-            // '''Breadth First Search connected graph with start node.
-            // Args:
-            //     graph (list): GRAPH represented by adjacent list, [set(1,2,3), set(...), ...].
-            //     start (int): Index of any start vertex.
-            // '''
-            std::deque<size_t> search_queue;
-            std::unordered_set<size_t> searched;
-            Indexes indexes;
-
-            search_queue.push_back(start);
-            while (!search_queue.empty())
-            {
-                auto cur_node = search_queue.front();
-                search_queue.pop_front();
-
-                if (searched.find(cur_node) != searched.end())
-                {
-                    continue;
-                }
-
-                indexes.insert(cur_node);
-
-                searched.insert(cur_node);
-                for (auto node : graph.at(cur_node))
-                {
-                    search_queue.push_back(node);
-                }
-            }
-
-            return indexes;
-        }
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <print>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "common.h"
+#include "fixed2_debugger.h"
+#include "mapped_file.h"
+
+// 识别结果的二进制归档，可以追加多页，读取时内存映射并按页随机访问
+//
+// 文件布局 (本机字节序，所有记录 4 字节对齐，每页从 8 字节边界开始)：
+//     FileHeader
+//     page 0, page 1, ...
+//     IndexEntry[page_count]
+//     Trailer
+// 每页的布局：
+//     PageHeader
+//     LineRecord[line_count]
+//     WordRecord[word_count]
+//     CharRecord[char_count]
+//     char text[text_size]   // 所有字符的 UTF-8 文本首尾相接
+namespace archive
+{
+    inline constexpr std::array<char, 4> magic{'I', 'P', 'A', 'R'};
+    inline constexpr uint32_t version = 2;
+
+    struct FileHeader
+    {
+        std::array<char, 4> magic;
+        uint32_t version;
+    };
+
+    struct IndexEntry
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct Trailer
+    {
+        uint64_t index_offset;
+        uint64_t page_count;
+        std::array<char, 4> magic;
+        uint32_t version;
+    };
+
+    struct PageHeader
+    {
+        uint32_t line_count;
+        uint32_t word_count;
+        uint32_t char_count;
+        uint32_t text_size;
+        uint32_t page_number; // 页面在源文件 (多页 TIFF) 中的页码，从 0 开始
+    };
+
+    struct LineRecord
+    {
+        Rect bbox;
+        uint32_t word_begin;
+        uint32_t word_end;
+    };
+
+    struct WordRecord
+    {
+        Rect bbox;
+        uint32_t char_begin;
+        uint32_t char_end;
+    };
+
+    struct CharRecord
+    {
+        Rect bbox;
+        uint32_t text_offset;
+        uint32_t text_size;
+        int32_t pointsize;
+    };
+
+    static_assert(std::is_trivially_copyable_v<LineRecord> && std::is_trivially_copyable_v<WordRecord> && std::is_trivially_copyable_v<CharRecord>);
+    static_assert(alignof(LineRecord) <= 8 && alignof(WordRecord) <= 8 && alignof(CharRecord) <= 8);
+
+    constexpr uint64_t align8(uint64_t n)
+    {
+        return (n + 7) & ~uint64_t(7);
+    }
+
+    // 一页的只读视图，直接引用映射的内存，不做任何解析和拷贝
+    struct PageView
+    {
+        std::span<const LineRecord> lines;
+        std::span<const WordRecord> words;
+        std::span<const CharRecord> chars;
+        std::string_view text;
+        uint32_t page_number{};
+
+        std::span<const WordRecord> words_of(const LineRecord &line) const
+        {
+            return words.subspan(line.word_begin, line.word_end - line.word_begin);
+        }
+
+        std::span<const CharRecord> chars_of(const WordRecord &word) const
+        {
+            return chars.subspan(word.char_begin, word.char_end - word.char_begin);
+        }
+
+        std::string_view text_of(const CharRecord &ch) const
+        {
+            return text.substr(ch.text_offset, ch.text_size);
+        }
+
+        fixed2_debugger::Page to_page() const
+        {
+            fixed2_debugger::Page page;
+            for (const auto &line : lines)
+            {
+                page.push_line(line.bbox);
+                for (const auto &word : words_of(line))
+                {
+                    page.push_word(word.bbox);
+                    for (const auto &ch : chars_of(word))
+                    {
+                        page.push_char(ch.bbox, text_of(ch), ch.pointsize);
+                    }
+                }
+            }
+            return page;
+        }
+    };
+
+    class Writer
+    {
+    public:
+        // 文件已存在时在原有页之后继续追加
+        explicit Writer(const std::filesystem::path &path) : m_path(path)
+        {
+            std::error_code ec;
+            if (std::filesystem::exists(path, ec) && std::filesystem::file_size(path, ec) > 0)
+            {
+                if (!load_index())
+                {
+                    return;
+                }
+                m_file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+                m_file.seekp(static_cast<std::streamoff>(m_end));
+            }
+            else
+            {
+                m_file.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+                write_pod(FileHeader{magic, version});
+                m_end = align8(sizeof(FileHeader));
+                pad_to(m_end);
+                m_created = true;
+            }
+            m_initial_end = m_end;
+            m_initial_count = m_index.size();
+
+            if (!m_file)
+            {
+                std::println(stderr, "Could not open archive {}.", path.string());
+            }
+        }
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        ~Writer()
+        {
+            close();
+        }
+
+        explicit operator bool() const
+        {
+            return m_file.is_open() && m_file.good();
+        }
+
+        size_t size() const
+        {
+            return m_index.size();
+        }
+
+        // 追加一页，返回它在归档中的序号；page_number 为它在源文件中的页码
+        size_t append(const fixed2_debugger::Page &page, uint32_t page_number = 0)
+        {
+            // 页面本身就是扁平的，记录与之一一对应，文本原样写出
+            std::vector<LineRecord> lines;
+            std::vector<WordRecord> words;
+            std::vector<CharRecord> chars;
+            const auto text = page.text();
+
+            lines.reserve(page.lines().size());
+            for (const auto &line : page.lines())
+            {
+                lines.push_back({line.bbox, line.word_begin, line.word_end});
+            }
+            words.reserve(page.words().size());
+            for (const auto &word : page.words())
+            {
+                words.push_back({word.bbox, word.char_begin, word.char_end});
+            }
+            chars.reserve(page.chars().size());
+            for (const auto &ch : page.chars())
+            {
+                chars.push_back({ch.bbox, ch.text_offset, ch.text_size, ch.pointsize});
+            }
+
+            const auto offset = m_end;
+            write_pod(PageHeader{static_cast<uint32_t>(lines.size()), static_cast<uint32_t>(words.size()),
+                                 static_cast<uint32_t>(chars.size()), static_cast<uint32_t>(text.size()), page_number});
+            write_array(std::span<const LineRecord>(lines));
+            write_array(std::span<const WordRecord>(words));
+            write_array(std::span<const CharRecord>(chars));
+            m_file.write(text.data(), static_cast<std::streamsize>(text.size()));
+
+            const auto size = sizeof(PageHeader) + lines.size() * sizeof(LineRecord) + words.size() * sizeof(WordRecord) + chars.size() * sizeof(CharRecord) + text.size();
+            m_end = align8(offset + size);
+            pad_to(m_end);
+
+            m_index.push_back({offset, size});
+            return m_index.size() - 1;
+        }
+
+        // 放弃本次写入的所有页：新建的文件被删除，追加的文件恢复成打开前的内容
+        void discard()
+        {
+            if (!m_file.is_open())
+            {
+                return;
+            }
+            if (m_created)
+            {
+                m_file.close();
+                std::error_code ec;
+                std::filesystem::remove(m_path, ec);
+                return;
+            }
+            m_index.resize(m_initial_count);
+            m_end = m_initial_end;
+            m_file.clear();
+            m_file.seekp(static_cast<std::streamoff>(m_end));
+            close();
+        }
+
+        // 写入索引和尾部，之后的 append 无效
+        void close()
+        {
+            if (!m_file.is_open())
+            {
+                return;
+            }
+            write_array(std::span<const IndexEntry>(m_index));
+            write_pod(Trailer{m_end, m_index.size(), magic, version});
+            const auto file_size = m_end + m_index.size() * sizeof(IndexEntry) + sizeof(Trailer);
+            m_file.close();
+
+            // 追加模式下覆盖了旧的索引，截掉可能残留的尾部
+            std::error_code ec;
+            std::filesystem::resize_file(m_path, file_size, ec);
+        }
+
+    private:
+        bool load_index()
+        {
+            const auto file = MappedFile::open(m_path.string());
+            if (!file || file->size() < sizeof(FileHeader) + sizeof(Trailer))
+            {
+                std::println(stderr, "Invalid archive {}.", m_path.string());
+                return false;
+            }
+
+            Trailer trailer;
+            std::memcpy(&trailer, file->data() + file->size() - sizeof(Trailer), sizeof(Trailer));
+            if (trailer.magic != magic || trailer.version != version ||
+                trailer.index_offset + trailer.page_count * sizeof(IndexEntry) + sizeof(Trailer) != file->size())
+            {
+                std::println(stderr, "Invalid archive {}.", m_path.string());
+                return false;
+            }
+
+            m_index.resize(trailer.page_count);
+            std::memcpy(m_index.data(), file->data() + trailer.index_offset, m_index.size() * sizeof(IndexEntry));
+            m_end = trailer.index_offset;
+            return true;
+        }
+
+        template <typename T>
+        void write_pod(const T &value)
+        {
+            m_file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void write_array(std::span<const T> values)
+        {
+            m_file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+        }
+
+        void pad_to(uint64_t offset)
+        {
+            static constexpr std::array<char, 8> zeros{};
+            const auto pos = static_cast<uint64_t>(m_file.tellp());
+            m_file.write(zeros.data(), static_cast<std::streamsize>(offset - pos));
+        }
+
+        std::filesystem::path m_path;
+        std::fstream m_file;
+        std::vector<IndexEntry> m_index;
+        uint64_t m_end{};
+        bool m_created{};
+        uint64_t m_initial_end{};
+        size_t m_initial_count{};
+    };
+
+    class Reader
+    {
+    public:
+        explicit Reader(const std::filesystem::path &path)
+        {
+            auto file = MappedFile::open(path.string());
+            if (!file || file->size() < sizeof(FileHeader) + sizeof(Trailer))
+            {
+                std::println(stderr, "Invalid archive {}.", path.string());
+                return;
+            }
+
+            Trailer trailer;
+            std::memcpy(&trailer, file->data() + file->size() - sizeof(Trailer), sizeof(Trailer));
+            if (trailer.magic != magic || trailer.version != version ||
+                trailer.index_offset + trailer.page_count * sizeof(IndexEntry) + sizeof(Trailer) != file->size())
+            {
+                std::println(stderr, "Invalid archive {}.", path.string());
+                return;
+            }
+
+            m_index = {reinterpret_cast<const IndexEntry *>(file->data() + trailer.index_offset), trailer.page_count};
+            m_file = std::move(file);
+        }
+
+        explicit operator bool() const
+        {
+            return m_file != nullptr;
+        }
+
+        size_t size() const
+        {
+            return m_index.size();
+        }
+
+        // 只解析所请求的那一页的头部，其它页不会被访问
+        PageView page(size_t index) const
+        {
+            if (index >= m_index.size())
+            {
+                return {};
+            }
+
+            // 偏移和大小来自文件，先确认整页都在文件内，再确认头部声明的各段加起来正好不超过这一页
+            // 计数都是 32 位，乘以记录大小后在 64 位内不会溢出，只有偏移与大小相加需要防止回绕
+            const auto &entry = m_index[index];
+            if (entry.offset > m_file->size() || entry.size > m_file->size() - entry.offset || entry.size < sizeof(PageHeader))
+            {
+                return {};
+            }
+            const auto base = m_file->data() + entry.offset;
+            PageHeader header;
+            std::memcpy(&header, base, sizeof(PageHeader));
+
+            const auto size = uint64_t(sizeof(PageHeader)) + uint64_t(header.line_count) * sizeof(LineRecord) +
+                              uint64_t(header.word_count) * sizeof(WordRecord) + uint64_t(header.char_count) * sizeof(CharRecord) +
+                              header.text_size;
+            if (size > entry.size)
+            {
+                return {};
+            }
+
+            auto p = base + sizeof(PageHeader);
+            PageView view;
+            view.lines = {reinterpret_cast<const LineRecord *>(p), header.line_count};
+            p += header.line_count * sizeof(LineRecord);
+            view.words = {reinterpret_cast<const WordRecord *>(p), header.word_count};
+            p += header.word_count * sizeof(WordRecord);
+            view.chars = {reinterpret_cast<const CharRecord *>(p), header.char_count};
+            p += header.char_count * sizeof(CharRecord);
+            view.text = {reinterpret_cast<const char *>(p), header.text_size};
+            view.page_number = header.page_number;
+            return view;
+        }
+
+    private:
+        std::shared_ptr<const MappedFile> m_file;
+        std::span<const IndexEntry> m_index;
+    };
+}
@@ -10,6 +10,21 @@
 #define default_lang "chi_sim+eng"
 #define default_tessdata "/usr/share/tessdata"
 #define default_font "/usr/share/fonts/TTF/msyh.ttc"
+#define default_oem 3 // tesseract::OEM_DEFAULT
+#define default_psm 6 // tesseract::PSM_SINGLE_BLOCK，与不设置时 TessBaseAPI 的默认值相同
+#define default_threads 0
+#define default_bands 1
+#define default_debug_level 0
+#define default_line_detector "rle"
+#define default_dpi 300
+
+// 调试输出的详细程度
+enum DebugLevel
+{
+    DebugNone = 0,         // 不渲染、不写任何调试图片
+    DebugResult = 1,       // 识别结果的渲染图
+    DebugIntermediate = 2, // 另外输出 blur/edges/lines 等中间结果
+};
 
 struct Args
 {
@@ -18,6 +33,25 @@ struct Args
     std::string lang;
     std::string tessdata;
     std::string font;
+    int oem{};
+    int psm{};
+    int threads{};
+    int bands{};
+    bool streaming{};
+    std::string archive;
+    int debug_level{};
+    std::string line_detector;
+    std::string bench;
+    bool cascade{};
+    std::string fast_lang;
+    std::string fast_tessdata;
+    int dpi{};
+    bool deskew{};
+
+    bool debug(DebugLevel level) const
+    {
+        return debug_level >= level;
+    }
 
     void print(FILE *stream = stdout) const
     {
@@ -29,6 +63,20 @@ struct Args
         std::println(stream, "lang: {}", lang);
         std::println(stream, "tessdata: {}", tessdata);
         std::println(stream, "font: {}", font);
+        std::println(stream, "oem: {}", oem);
+        std::println(stream, "psm: {}", psm);
+        std::println(stream, "threads: {}", threads);
+        std::println(stream, "bands: {}", bands);
+        std::println(stream, "streaming: {}", streaming);
+        std::println(stream, "archive: {}", archive);
+        std::println(stream, "debug level: {}", debug_level);
+        std::println(stream, "line detector: {}", line_detector);
+        std::println(stream, "bench: {}", bench);
+        std::println(stream, "cascade: {}", cascade);
+        std::println(stream, "fast lang: {}", fast_lang);
+        std::println(stream, "fast tessdata: {}", fast_tessdata);
+        std::println(stream, "dpi: {}", dpi);
+        std::println(stream, "deskew: {}", deskew);
     }
 
     static Args from(int argc, char **argv)
@@ -38,10 +86,24 @@ struct Args
 
         auto opts_adder = options.add_options();
         opts_adder("c,confidence", "Confidence", cxxopts::value<int>()->default_value(std::to_string(default_confidence)));
-        opts_adder("i,images", "Image paths, can be multiple", cxxopts::value<std::vector<std::string>>());
+        opts_adder("i,images", "Image paths, can be multiple; with --stream, - reads paths from stdin and @file from a list file", cxxopts::value<std::vector<std::string>>());
         opts_adder("l,lang", "Language", cxxopts::value<std::string>()->default_value(default_lang));
         opts_adder("t,tessdata", "Tessdata path", cxxopts::value<std::string>()->default_value(default_tessdata));
         opts_adder("f,font", "Font path", cxxopts::value<std::string>()->default_value(default_font));
+        opts_adder("oem", "OCR engine mode", cxxopts::value<int>()->default_value(std::to_string(default_oem)));
+        opts_adder("psm", "Page segmentation mode (Tesseract PageSegMode, default keeps the library default 6)", cxxopts::value<int>()->default_value(std::to_string(default_psm)));
+        opts_adder("j,threads", "Batch worker threads, 0 disables batch mode", cxxopts::value<int>()->default_value(std::to_string(default_threads)));
+        opts_adder("bands", "Split each page into N horizontal bands recognised in parallel (single-image mode only; batch and streaming modes already run pages in parallel)", cxxopts::value<int>()->default_value(std::to_string(default_bands)));
+        opts_adder("s,stream", "Stream images through a pipelined batch, reading stdin when no images are given");
+        opts_adder("a,archive", "Append recognised pages to a binary archive", cxxopts::value<std::string>()->default_value(""));
+        opts_adder("d,debug-level", "Debug output: 0 none, 1 rendered results, 2 also intermediate images", cxxopts::value<int>()->default_value(std::to_string(default_debug_level)));
+        opts_adder("line-detector", "Table rule detector: rle or hough", cxxopts::value<std::string>()->default_value(default_line_detector));
+        opts_adder("bench", "Run a benchmark instead of recognising: lines, extract, hash", cxxopts::value<std::string>()->default_value(""));
+        opts_adder("cascade", "Recognise with a fast engine first, then re-recognise only lines below --confidence with the full engine; requires --fast-lang or --fast-tessdata");
+        opts_adder("fast-lang", "Language of the fast cascade pass, defaults to --lang", cxxopts::value<std::string>()->default_value(""));
+        opts_adder("fast-tessdata", "Tessdata path of the fast cascade pass, e.g. tessdata_fast, defaults to --tessdata", cxxopts::value<std::string>()->default_value(""));
+        opts_adder("dpi", "Downscale images above this resolution before recognition, 0 keeps the original size", cxxopts::value<int>()->default_value(std::to_string(default_dpi)));
+        opts_adder("no-deskew", "Do not deskew images before recognition");
         opts_adder("h,help", "Show help");
 
         const auto result = options.parse(argc, argv);
@@ -52,12 +114,37 @@ struct Args
             exit(0);
         }
 
+        // 两级使用同一个模型时第一级没有任何加速，低置信度的行反而要识别两遍
+        auto cascade = result["cascade"].as<bool>();
+        const auto fast_lang = result["fast-lang"].as<std::string>();
+        const auto fast_tessdata = result["fast-tessdata"].as<std::string>();
+        if (cascade && (fast_lang.empty() || fast_lang == result["lang"].as<std::string>()) &&
+            (fast_tessdata.empty() || fast_tessdata == result["tessdata"].as<std::string>()))
+        {
+            std::println(stderr, "--cascade needs a different model via --fast-lang or --fast-tessdata, ignoring it.");
+            cascade = false;
+        }
+
         return {
             result["confidence"].as<int>(),
-            result["images"].as<std::vector<std::string>>(),
+            result.count("images") ? result["images"].as<std::vector<std::string>>() : std::vector<std::string>{},
             result["lang"].as<std::string>(),
             result["tessdata"].as<std::string>(),
             result["font"].as<std::string>(),
+            result["oem"].as<int>(),
+            result["psm"].as<int>(),
+            result["threads"].as<int>(),
+            result["bands"].as<int>(),
+            result["stream"].as<bool>(),
+            result["archive"].as<std::string>(),
+            result["debug-level"].as<int>(),
+            result["line-detector"].as<std::string>(),
+            result["bench"].as<std::string>(),
+            cascade,
+            fast_lang,
+            fast_tessdata,
+            result["dpi"].as<int>(),
+            !result["no-deskew"].as<bool>(),
         };
     }
 };
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <print>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "args.h"
+#include "common.h"
+#include "engine_pool.h"
+#include "flat_hash.h"
+#include "image.h"
+#include "recognise.h"
+
+// 命令行基准测试，--bench <name> 选择要运行的测试，lines 的输入为 images 中的图片
+class Bench
+{
+public:
+    static constexpr int rounds = 5;
+
+    static int run(const Args &args)
+    {
+        if (args.bench == "lines")
+        {
+            return lines(args);
+        }
+        if (args.bench == "extract")
+        {
+            return extract(args);
+        }
+        if (args.bench == "hash")
+        {
+            return hash();
+        }
+        std::println(stderr, "Unknown benchmark {}.", args.bench);
+        return 1;
+    }
+
+    // 对比 Hough 与游程两种横竖线检测的耗时，以及彼此的召回率
+    static int lines(const Args &args)
+    {
+        double hough_total = 0, rle_total = 0;
+        for (const auto &path : args.images)
+        {
+            const auto image = Image::read(path);
+            if (!image)
+            {
+                continue;
+            }
+
+            // 每一轮使用新的 PageContext，计时包含灰度转换以及各自的中间结果，不命中缓存
+            Rects hough, rle;
+            const auto hough_ms = time_ms([&]
+                                          {
+                PageContext context(image);
+                hough = Recognise::hough_segments(context); });
+            const auto rle_ms = time_ms([&]
+                                        {
+                PageContext context(image);
+                rle = Recognise::rle_segments(context); });
+            hough_total += hough_ms;
+            rle_total += rle_ms;
+
+            std::println("{}\though: {} segments {:.2f}ms\trle: {} segments {:.2f}ms\trle covers hough: {:.1f}%\though covers rle: {:.1f}%",
+                         path, hough.size(), hough_ms, rle.size(), rle_ms, 100 * recall(hough, rle), 100 * recall(rle, hough));
+        }
+        std::println("total\though: {:.2f}ms\trle: {:.2f}ms\tspeedup: {:.2f}x", hough_total, rle_total, rle_total > 0 ? hough_total / rle_total : 0.0);
+        return 0;
+    }
+
+    // 识别结果提取与 Recognize 的耗时对比，提取可以在同一份识别结果上重复执行
+    static int extract(const Args &args)
+    {
+        auto engine = EnginePool::instance().acquire(args);
+        if (!engine)
+        {
+            return 1;
+        }
+
+        fixed2_debugger::Page page;
+        for (const auto &path : args.images)
+        {
+            const auto image = Image::read(path);
+            if (!image)
+            {
+                continue;
+            }
+
+            engine->Clear();
+            engine->SetImage(image->pix.get());
+            const auto start = std::chrono::steady_clock::now();
+            if (engine->Recognize(nullptr))
+            {
+                std::println(stderr, "Recognize failed");
+                continue;
+            }
+            const auto recognise_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            const auto extract_ms = time_ms([&]
+                                            { Recognise::extract_page(*engine, page); });
+
+            std::println("{}\tchars: {}\trecognise: {:.2f}ms\textract: {:.3f}ms\t{:.2f}%",
+                         path, page.chars().size(), recognise_ms, extract_ms, recognise_ms > 0 ? 100 * extract_ms / recognise_ms : 0.0);
+        }
+        return 0;
+    }
+
+    // 模拟一页的字符框 (等宽等高的网格)，对比旧的异或哈希、新的混合哈希以及开放寻址表的插入和查找耗时
+    static int hash()
+    {
+        Rects boxes;
+        for (int line = 0; line < 200; ++line)
+        {
+            for (int col = 0; col < 100; ++col)
+            {
+                boxes.push_back({col * 24, line * 32, col * 24 + 20, line * 32 + 24});
+            }
+        }
+
+        struct XorHash
+        {
+            size_t operator()(const Rect &rect) const
+            {
+                return std::hash<int>()(rect.x0) ^ std::hash<int>()(rect.y0) ^ std::hash<int>()(rect.x1) ^ std::hash<int>()(rect.y1);
+            }
+        };
+
+        const auto measure = [&]<typename Set>(const char *name, Set &set)
+        {
+            size_t found = 0;
+            const auto ms = time_ms([&]
+                                    {
+                set.clear();
+                for (const auto &box : boxes)
+                {
+                    set.insert(box);
+                }
+                found = 0;
+                for (const auto &box : boxes)
+                {
+                    found += set.count(box);
+                } });
+            std::println("{}\tboxes: {}\tunique: {}\tfound: {}\t{:.2f}ms", name, boxes.size(), set.size(), found, ms);
+        };
+
+        std::unordered_set<Rect, XorHash> xor_set;
+        measure("unordered_set<Rect> xor hash", xor_set);
+        std::unordered_set<Rect> mixed_set;
+        measure("unordered_set<Rect> mixed hash", mixed_set);
+        FlatHashSet<Rect> flat_set;
+        measure("FlatHashSet<Rect>", flat_set);
+
+        // 异或哈希下的值大量重复，不同的哈希值个数远小于框的个数
+        std::unordered_set<size_t> xor_values, mixed_values;
+        for (const auto &box : boxes)
+        {
+            xor_values.insert(XorHash()(box));
+            mixed_values.insert(std::hash<Rect>()(box));
+        }
+        std::println("distinct hash values\txor: {}\tmixed: {}", xor_values.size(), mixed_values.size());
+        return 0;
+    }
+
+    // expected 中被 found 覆盖的线段比例：方向相同，垂直方向相差不超过 tolerance，
+    // 且 found 中的线段合起来覆盖 expected 至少 min_overlap 的长度
+    static double recall(const Rects &expected, const Rects &found, int tolerance = 2, double min_overlap = 0.8)
+    {
+        if (expected.empty())
+        {
+            return 1.0;
+        }
+
+        // 统一成 (所在行/列, 起点, 终点)，横线和竖线分开按所在行/列排序，之后二分查找
+        struct Span
+        {
+            int pos, begin, end;
+        };
+        const auto spans = [](const Rects &rects, bool horizontal)
+        {
+            std::vector<Span> result;
+            for (const auto &r : rects)
+            {
+                if ((r.y0 == r.y1) == horizontal)
+                {
+                    result.push_back(horizontal ? Span{r.y0, r.x0, r.x1} : Span{r.x0, r.y0, r.y1});
+                }
+            }
+            std::ranges::sort(result, {}, &Span::pos);
+            return result;
+        };
+
+        size_t covered = 0;
+        for (const auto horizontal : {true, false})
+        {
+            const auto targets = spans(found, horizontal);
+            for (const auto &e : spans(expected, horizontal))
+            {
+                const auto first = std::ranges::lower_bound(targets, e.pos - tolerance, {}, &Span::pos);
+                const auto last = std::ranges::upper_bound(targets, e.pos + tolerance, {}, &Span::pos);
+                int overlap = 0;
+                for (auto it = first; it != last; ++it)
+                {
+                    overlap += std::max(0, std::min(e.end, it->end) - std::max(e.begin, it->begin) + 1);
+                }
+                if (overlap >= min_overlap * (e.end - e.begin + 1))
+                {
+                    ++covered;
+                }
+            }
+        }
+        return static_cast<double>(covered) / expected.size();
+    }
+
+private:
+    template <typename F>
+    static double time_ms(F &&f)
+    {
+        double best = 0;
+        for (int i = 0; i < rounds; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best = i == 0 ? elapsed : std::min(best, elapsed);
+        }
+        return best;
+    }
+};
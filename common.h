@@ -1,14 +1,21 @@
 #pragma once
 
 #include <array>
+#include <bit>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <format>
 #include <stdexcept>
 #include <cmath>
 #include <vector>
 
+#include <leptonica/allheaders.h>
+
 #include <opencv2/opencv.hpp>
 
+#include "flat_hash.h"
+
 template <typename T>
 struct _Point
 {
@@ -421,7 +428,136 @@ namespace std
     {
         size_t operator()(const _Rect<T> &rect) const
         {
-            return std::hash<T>()(rect.x0) ^ std::hash<T>()(rect.y0) ^ std::hash<T>()(rect.x1) ^ std::hash<T>()(rect.y1);
+            // 不能用异或：对称或平移后的矩形会得到相同的值
+            auto h = std::hash<T>()(rect.x0);
+            h = hash_combine(h, std::hash<T>()(rect.y0));
+            h = hash_combine(h, std::hash<T>()(rect.x1));
+            return hash_combine(h, std::hash<T>()(rect.y1));
         }
     };
-}
\ No newline at end of file
+}
+
+// 识别出的一个字的哈希：同一个字会在页面上反复出现，只用文本做哈希会全部落到同一个桶里
+inline size_t hash_glyph(std::string_view text, const Rect &bbox, int pointsize)
+{
+    auto h = std::hash<std::string_view>()(text);
+    h = hash_combine(h, std::hash<Rect>()(bbox));
+    return hash_combine(h, std::hash<int>()(pointsize));
+}
+
+// Leptonica Pix 与 cv::Mat 之间的桥接，两者共享同一份解码后的像素
+//
+// 32 bpp: Pix 的每个像素是一个本机字节序的 l_uint32，R 位于最高字节，
+//         所以直接用 CV_8UC4 视图包装 Pix 的数据即可，不拷贝；
+//         小端机器上的通道顺序为 A,B,G,R，大端机器上为 R,G,B,A，见 channel()。
+// 8 bpp:  Pix 按 32 位字大端打包，小端机器上每个字内的 4 个字节是反序的，
+//         无法直接按行访问，需要一次 pixEndianByteSwapNew 拷贝；大端机器上不拷贝。
+// 其它位深 (1/2/4/16 bpp 或带调色板) 先用 pixConvertTo8 转换成 8 bpp 灰度。
+struct PixMat
+{
+    std::shared_ptr<Pix> pix; // 持有像素，view 引用其中的数据
+    cv::Mat view;             // CV_8UC1 或 CV_8UC4
+
+    enum Channel
+    {
+        Red = 0,
+        Green = 1,
+        Blue = 2,
+        Alpha = 3,
+    };
+
+    // 32 bpp 像素中各颜色分量所在的字节下标
+    static constexpr int channel(Channel c)
+    {
+        return std::endian::native == std::endian::little ? 3 - c : c;
+    }
+
+    static std::shared_ptr<Pix> own(Pix *pix)
+    {
+        return std::shared_ptr<Pix>(pix, [](Pix *p)
+                                    { pixDestroy(&p); });
+    }
+
+    static PixMat wrap(const std::shared_ptr<Pix> &pix)
+    {
+        if (!pix)
+        {
+            return {};
+        }
+
+        auto src = pix;
+        if (pixGetColormap(src.get()) || (pixGetDepth(src.get()) != 8 && pixGetDepth(src.get()) != 32))
+        {
+            src = own(pixConvertTo8(src.get(), 0));
+        }
+
+        const auto depth = pixGetDepth(src.get());
+        if (depth == 8 && std::endian::native == std::endian::little)
+        {
+            src = own(pixEndianByteSwapNew(src.get()));
+        }
+
+        return {src, cv::Mat(pixGetHeight(src.get()), pixGetWidth(src.get()), depth == 8 ? CV_8UC1 : CV_8UC4,
+                             pixGetData(src.get()), pixGetWpl(src.get()) * sizeof(l_uint32))};
+    }
+
+    // 灰度图：8 bpp 时直接返回视图，32 bpp 时做一次加权转换
+    cv::Mat gray() const
+    {
+        if (view.empty() || view.channels() == 1)
+        {
+            return view;
+        }
+        std::array<float, 4> weights{};
+        weights[channel(Red)] = 0.299f;
+        weights[channel(Green)] = 0.587f;
+        weights[channel(Blue)] = 0.114f;
+        cv::Mat result;
+        cv::transform(view, result, cv::Mat(1, 4, CV_32F, weights.data()));
+        return result;
+    }
+
+    // OpenCV 习惯的 BGR 图：一次通道重排
+    cv::Mat bgr() const
+    {
+        cv::Mat result;
+        if (view.empty())
+        {
+            return result;
+        }
+        if (view.channels() == 1)
+        {
+            cv::cvtColor(view, result, cv::COLOR_GRAY2BGR);
+            return result;
+        }
+        result.create(view.size(), CV_8UC3);
+        const std::array<int, 6> from_to{channel(Blue), 0, channel(Green), 1, channel(Red), 2};
+        cv::mixChannels(&view, 1, &result, 1, from_to.data(), 3);
+        return result;
+    }
+
+    // cv::Mat (CV_8UC1 / CV_8UC3) 转成 Pix，一次拷贝
+    static std::shared_ptr<Pix> from(const cv::Mat &mat)
+    {
+        if (mat.type() == CV_8UC1)
+        {
+            auto pix = own(pixCreate(mat.cols, mat.rows, 8));
+            cv::Mat view(mat.rows, mat.cols, CV_8UC1, pixGetData(pix.get()), pixGetWpl(pix.get()) * sizeof(l_uint32));
+            mat.copyTo(view);
+            if (std::endian::native == std::endian::little)
+            {
+                pixEndianByteSwap(pix.get());
+            }
+            return pix;
+        }
+        if (mat.type() == CV_8UC3)
+        {
+            auto pix = own(pixCreate(mat.cols, mat.rows, 32));
+            cv::Mat view(mat.rows, mat.cols, CV_8UC4, pixGetData(pix.get()), pixGetWpl(pix.get()) * sizeof(l_uint32));
+            const std::array<int, 6> from_to{0, channel(Blue), 1, channel(Green), 2, channel(Red)};
+            cv::mixChannels(&mat, 1, &view, 1, from_to.data(), 3);
+            return pix;
+        }
+        throw std::invalid_argument("Unsupported cv::Mat type");
+    }
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <print>
+#include <string>
+#include <thread>
+
+#include "queue.h"
+
+#include <leptonica/allheaders.h>
+
+#include <opencv2/opencv.hpp>
+
+// 调试图片的后台写入线程，编码和写文件不占用识别的关键路径
+// 队列有界，写入跟不上时提交方阻塞，内存不会无限增长
+class DebugWriter
+{
+public:
+    static constexpr size_t queue_capacity = 8;
+
+    static DebugWriter &instance()
+    {
+        static DebugWriter writer;
+        return writer;
+    }
+
+    DebugWriter(const DebugWriter &) = delete;
+    DebugWriter &operator=(const DebugWriter &) = delete;
+
+    // 退出前写完队列中剩余的图片
+    ~DebugWriter()
+    {
+        m_jobs.close();
+    }
+
+    // 提交之后调用方不能再修改 mat 的像素
+    void write(std::string path, cv::Mat mat)
+    {
+        post([path = std::move(path), mat = std::move(mat)]
+             {
+            if (!cv::imwrite(path, mat))
+            {
+                std::println(stderr, "Failed to write debug image to {}", path);
+            } });
+    }
+
+    void write(std::string path, std::shared_ptr<Pix> pix)
+    {
+        post([path = std::move(path), pix = std::move(pix)]
+             {
+            if (pixWrite(path.c_str(), pix.get(), IFF_PNG))
+            {
+                std::println(stderr, "Failed to write debug image to {}", path);
+            } });
+    }
+
+private:
+    DebugWriter() : m_thread([this]
+                             {
+        while (auto job = m_jobs.pop())
+        {
+            (*job)();
+        } })
+    {
+    }
+
+    void post(std::function<void()> job)
+    {
+        m_jobs.push(std::move(job));
+    }
+
+    BoundedQueue<std::function<void()>> m_jobs{queue_capacity};
+    std::jthread m_thread;
+};
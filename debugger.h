@@ -3,12 +3,14 @@
 #include <memory>
 #include <string>
 #include <print>
-#include <unordered_set>
 #include <ranges>
-#include <filesystem>
 
 #include "args.h"
 #include "common.h"
+#include "debug_writer.h"
+#include "flat_hash.h"
+#include "glyph_cache.h"
+#include "image.h"
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -18,7 +20,6 @@
 #include <opencv4/opencv2/opencv.hpp>
 #include <opencv4/opencv2/imgproc.hpp>
 #include <opencv4/opencv2/imgcodecs.hpp>
-#include <opencv4/opencv2/freetype.hpp>
 
 #define CV_COLOR_RED cv::Scalar(0, 0, 255)
 #define CV_COLOR_GREEN cv::Scalar(0, 255, 0)
@@ -48,7 +49,7 @@ namespace std
     {
         size_t operator()(const CharInfo &info) const
         {
-            return std::hash<std::string>()(info.text);
+            return hash_glyph(info.text, info.bbox, info.pointsize);
         }
     };
 }
@@ -58,15 +59,27 @@ class Debugger
 public:
     Debugger(const Args &args) : m_args(args)
     {
-        m_ft2 = cv::freetype::createFreeType2();
-        m_ft2->loadFontData(m_args.font, 0);
+        if (!enabled())
+        {
+            return;
+        }
+        m_glyphs = std::make_shared<GlyphCache>(m_args.font);
+    }
+
+    // 调试级别不够时不加载字体、不收集、不渲染
+    bool enabled() const
+    {
+        return m_args.debug(DebugResult);
     }
 
-    void set_image(const std::string &image_path)
+    void set_image(const ImagePtr &image)
     {
-        m_image_path = image_path;
-        m_bitmap = cv::imread(image_path, cv::IMREAD_COLOR);
-        m_bitmap = cv::Scalar(255, 255, 255);
+        if (!enabled())
+        {
+            return;
+        }
+        m_debug_stem = image->debug_stem();
+        m_bitmap = image->canvas(CV_COLOR_WHITE);
     }
 
     ~Debugger()
@@ -76,28 +89,43 @@ public:
 
     void on_line(const Rect &line_bbox)
     {
+        if (!enabled())
+        {
+            return;
+        }
         m_line_bboxes.insert(line_bbox);
     }
 
     void on_word(const Rect &word_bbox)
     {
+        if (!enabled())
+        {
+            return;
+        }
         m_word_bboxes.insert(word_bbox);
     }
 
     void on_char(const Rect &char_bbox, const std::string &text, int pointsize)
     {
+        if (!enabled())
+        {
+            return;
+        }
         m_chars.insert(CharInfo{text, char_bbox, pointsize});
     }
 
     void putChineseText(const std::string &text, Rect rect, cv::Scalar color)
     {
-        int baseline = 0;
-        m_ft2->getTextSize(text, rect.height(), -1, &baseline);
-        m_ft2->putText(m_bitmap, text, cv::Point(rect.x0, rect.y0 + baseline), rect.height(), color, -1, cv::LINE_AA, false);
+        const auto baseline = m_glyphs->baseline(text, rect.height());
+        m_glyphs->put_text(m_bitmap, text, cv::Point(rect.x0, rect.y0 + baseline), rect.height(), color);
     }
 
     void flush()
     {
+        if (!enabled())
+        {
+            return;
+        }
         for (const auto &line_bbox : m_line_bboxes)
         {
             // println("line bbox: {}", line_bbox.to_string());
@@ -117,15 +145,15 @@ public:
         m_line_bboxes.clear();
         m_word_bboxes.clear();
         m_chars.clear();
-        cv::imwrite(std::format("{}.dbg.png", std::filesystem::path(m_image_path).filename().string()).c_str(), m_bitmap);
+        DebugWriter::instance().write(std::format("{}.dbg.png", m_debug_stem), std::exchange(m_bitmap, {}));
     }
 
 private:
     Args m_args;
-    std::string m_image_path;
-    cv::Ptr<cv::freetype::FreeType2> m_ft2;
+    std::string m_debug_stem;
+    std::shared_ptr<GlyphCache> m_glyphs;
     cv::Mat m_bitmap;
-    std::unordered_set<Rect> m_line_bboxes;
-    std::unordered_set<Rect> m_word_bboxes;
-    std::unordered_set<CharInfo> m_chars;
+    FlatHashSet<Rect> m_line_bboxes;
+    FlatHashSet<Rect> m_word_bboxes;
+    FlatHashSet<CharInfo> m_chars;
 };
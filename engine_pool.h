@@ -0,0 +1,193 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <print>
+#include <unordered_map>
+
+#include "args.h"
+
+#include <tesseract/baseapi.h>
+
+struct EngineKey
+{
+    std::string tessdata;
+    std::string lang;
+    int oem{default_oem};
+    int psm{default_psm};
+
+    bool operator==(const EngineKey &other) const
+    {
+        return tessdata == other.tessdata && lang == other.lang && oem == other.oem && psm == other.psm;
+    }
+
+    static EngineKey from(const Args &args)
+    {
+        return {args.tessdata, args.lang, args.oem, args.psm};
+    }
+
+    // --cascade 第一级使用的快速引擎，未指定的参数与完整引擎相同
+    static EngineKey fast_from(const Args &args)
+    {
+        return {args.fast_tessdata.empty() ? args.tessdata : args.fast_tessdata,
+                args.fast_lang.empty() ? args.lang : args.fast_lang,
+                args.oem, args.psm};
+    }
+};
+
+namespace std
+{
+    template <>
+    struct hash<EngineKey>
+    {
+        size_t operator()(const EngineKey &key) const
+        {
+            auto h = std::hash<std::string>()(key.tessdata);
+            h = h * 31 + std::hash<std::string>()(key.lang);
+            h = h * 31 + std::hash<int>()(key.oem);
+            h = h * 31 + std::hash<int>()(key.psm);
+            return h;
+        }
+    };
+}
+
+class EnginePool;
+
+// 从引擎池借出的 TessBaseAPI，析构时 Clear() 并归还给引擎池
+class Engine
+{
+public:
+    Engine() = default;
+
+    Engine(EnginePool *pool, EngineKey key, std::unique_ptr<tesseract::TessBaseAPI> api)
+        : m_pool(pool), m_key(std::move(key)), m_api(std::move(api))
+    {
+    }
+
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
+
+    Engine(Engine &&other) noexcept = default;
+
+    Engine &operator=(Engine &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            m_pool = other.m_pool;
+            m_key = std::move(other.m_key);
+            m_api = std::move(other.m_api);
+        }
+        return *this;
+    }
+
+    ~Engine()
+    {
+        release();
+    }
+
+    tesseract::TessBaseAPI *get() const
+    {
+        return m_api.get();
+    }
+
+    tesseract::TessBaseAPI *operator->() const
+    {
+        return m_api.get();
+    }
+
+    tesseract::TessBaseAPI &operator*() const
+    {
+        return *m_api;
+    }
+
+    explicit operator bool() const
+    {
+        return m_api != nullptr;
+    }
+
+    const EngineKey &key() const
+    {
+        return m_key;
+    }
+
+    void release();
+
+private:
+    EnginePool *m_pool{};
+    EngineKey m_key;
+    std::unique_ptr<tesseract::TessBaseAPI> m_api;
+};
+
+// 按 (tessdata, lang, oem, psm) 缓存已初始化的 TessBaseAPI，模型只加载一次
+class EnginePool
+{
+public:
+    static EnginePool &instance()
+    {
+        static EnginePool pool;
+        return pool;
+    }
+
+    Engine acquire(const EngineKey &key)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            auto it = m_idle.find(key);
+            if (it != m_idle.end() && !it->second.empty())
+            {
+                auto api = std::move(it->second.back());
+                it->second.pop_back();
+                return Engine(this, key, std::move(api));
+            }
+        }
+
+        // 初始化在锁外进行，多个 worker 可以同时加载模型
+        auto api = std::make_unique<tesseract::TessBaseAPI>();
+        if (api->Init(key.tessdata.c_str(), key.lang.c_str(), static_cast<tesseract::OcrEngineMode>(key.oem)))
+        {
+            std::println(stderr, "Could not initialize tesseract.");
+            return {};
+        }
+        api->SetPageSegMode(static_cast<tesseract::PageSegMode>(key.psm));
+        return Engine(this, key, std::move(api));
+    }
+
+    Engine acquire(const Args &args)
+    {
+        return acquire(EngineKey::from(args));
+    }
+
+    void release(const EngineKey &key, std::unique_ptr<tesseract::TessBaseAPI> api)
+    {
+        // 释放图像和识别结果，保留已加载的模型
+        api->Clear();
+
+        std::lock_guard lock(m_mutex);
+        m_idle[key].push_back(std::move(api));
+    }
+
+    size_t idle(const EngineKey &key)
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_idle.find(key);
+        return it == m_idle.end() ? 0 : it->second.size();
+    }
+
+private:
+    EnginePool() = default;
+
+    std::mutex m_mutex;
+    std::unordered_map<EngineKey, std::vector<std::unique_ptr<tesseract::TessBaseAPI>>> m_idle;
+};
+
+inline void Engine::release()
+{
+    if (m_pool && m_api)
+    {
+        m_pool->release(m_key, std::move(m_api));
+    }
+    m_api.reset();
+}
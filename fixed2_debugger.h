@@ -1,20 +1,30 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 #include <print>
-#include <unordered_map>
 #include <filesystem>
 #include <numeric>
 #include "args.h"
 #include "common.h"
+#include "debug_writer.h"
+#include "glyph_cache.h"
+#include "image.h"
 
 #include <leptonica/allheaders.h>
 
 #include <opencv4/opencv2/opencv.hpp>
 #include <opencv4/opencv2/imgproc.hpp>
 #include <opencv4/opencv2/imgcodecs.hpp>
-#include <opencv4/opencv2/freetype.hpp>
 
 #define CV_COLOR_RED cv::Scalar(0, 0, 255)
 #define CV_COLOR_GREEN cv::Scalar(0, 255, 0)
@@ -27,232 +37,471 @@
 
 namespace fixed2_debugger
 {
+    // Page 的扁平表示：所有行、词、字各存一个数组，上一级用下标区间引用下一级，
+    // 字的文本首尾相接存放在一个字符串中，Char 只保存偏移和长度
     struct Char
     {
         Rect bbox;
-        std::string text;
+        uint32_t text_offset;
+        uint32_t text_size;
         int pointsize;
+    };
+
+    struct Word
+    {
+        Rect bbox;
+        uint32_t char_begin;
+        uint32_t char_end;
+    };
 
-        void draw(cv::Ptr<cv::freetype::FreeType2> &ft2, cv::Mat &bitmap) const
+    struct Line
+    {
+        Rect bbox;
+        uint32_t word_begin;
+        uint32_t word_end;
+    };
+
+    // 数组都从页面自己的 arena (单调分配器) 分配，页面销毁或 clear() 时整体释放，
+    // clear() 之后 arena 的首块内存保留下来，复用同一个 Page 识别下一张图片时不再向系统申请内存
+    //
+    // 不变式：同一行的词、同一个词的字在数组中连续且按顺序排列，
+    // 相邻两个词的字区间首尾相接 (前一个词的 char_end 等于后一个词的 char_begin)
+    class Page
+    {
+    public:
+        // 逐字构建的页面 arena 从这个大小起步；拷贝和合并时内容大小已知，首块按内容分配
+        static constexpr size_t arena_initial_size = 64 * 1024;
+
+        Page() = default;
+
+        Page(const Page &other)
         {
-            // println("{} bbox: {}", __func__, bbox.to_string());
-            draw_text(ft2, bitmap);
-            cv::rectangle(bitmap, cv::Point(bbox.x0, bbox.y0), cv::Point(bbox.x1, bbox.y1), CV_COLOR_RED, 1, cv::LINE_4, 0);
+            append(other);
         }
 
-        void draw_text(cv::Ptr<cv::freetype::FreeType2> &ft2, cv::Mat &bitmap) const
+        Page &operator=(const Page &other)
         {
-            int baseline = 0;
-            try
-            {
-                ft2->getTextSize(text, bbox.height(), -1, &baseline);
-                ft2->putText(bitmap, text, cv::Point(bbox.x0, bbox.y0 + baseline), bbox.height(), CV_COLOR_BLACK, -1, cv::LINE_AA, false);
-            }
-            catch (const cv::Exception &e)
+            if (this != &other)
             {
-                std::println("{}", e.what());
+                clear();
+                append(other);
             }
+            return *this;
         }
-    };
 
-    struct Word
-    {
-        Rect bbox;
-        std::vector<Char> chars;
+        Page(Page &&) noexcept = default;
+        Page &operator=(Page &&) noexcept = default;
 
-        void reflow()
+        std::span<const Line> lines() const { return m_storage ? std::span<const Line>(m_storage->lines) : std::span<const Line>(); }
+        std::span<const Word> words() const { return m_storage ? std::span<const Word>(m_storage->words) : std::span<const Word>(); }
+        std::span<const Char> chars() const { return m_storage ? std::span<const Char>(m_storage->chars) : std::span<const Char>(); }
+        std::string_view text() const { return m_storage ? std::string_view(m_storage->text) : std::string_view(); }
+
+        std::span<const Word> words_of(const Line &line) const
+        {
+            return words().subspan(line.word_begin, line.word_end - line.word_begin);
+        }
+
+        std::span<const Char> chars_of(const Word &word) const
+        {
+            return chars().subspan(word.char_begin, word.char_end - word.char_begin);
+        }
+
+        std::string_view text_of(const Char &ch) const
+        {
+            return text().substr(ch.text_offset, ch.text_size);
+        }
+
+        bool empty() const
         {
-            Word word;
+            return lines().empty();
+        }
 
-            for (auto &&[lhs, rhs] : std::ranges::views::pairwise(chars))
+        // 释放所有行、词、字，保留 arena 的首块内存
+        void clear()
+        {
+            if (m_storage)
             {
-                auto ch = lhs;
-                // limit the width of the character to fit the height of the character
-                ch.bbox = ch.bbox.clip_left(std::min(ch.bbox.x0 + ch.bbox.height() * 6 / 5, rhs.bbox.x0 - 1));
-                word.bbox |= ch.bbox;
-                word.chars.emplace_back(ch);
+                m_storage->reset();
             }
+        }
 
-            // last character
-            auto ch = chars.back();
-            ch.bbox = ch.bbox.clip_left(ch.bbox.x0 + ch.bbox.height() * 6 / 5);
-            word.bbox |= ch.bbox;
-            word.chars.emplace_back(ch);
+        // 逐层追加，调用方保证顺序：先行，再行内的词，再词内的字
+        void push_line(const Rect &bbox)
+        {
+            auto &s = storage();
+            const auto words = static_cast<uint32_t>(s.words.size());
+            s.lines.push_back({bbox, words, words});
+        }
 
-            word.resize();
+        void push_word(const Rect &bbox)
+        {
+            auto &s = storage();
+            const auto chars = static_cast<uint32_t>(s.chars.size());
+            s.words.push_back({bbox, chars, chars});
+            s.lines.back().word_end = static_cast<uint32_t>(s.words.size());
+        }
 
-            *this = std::move(word);
+        void push_char(const Rect &bbox, std::string_view text, int pointsize)
+        {
+            auto &s = storage();
+            s.chars.push_back({bbox, static_cast<uint32_t>(s.text.size()), static_cast<uint32_t>(text.size()), pointsize});
+            s.text += text;
+            s.words.back().char_end = static_cast<uint32_t>(s.chars.size());
         }
 
-        void resize()
+        void append_char(const Rect &line_bbox, const Rect &word_bbox, const Rect &char_bbox, std::string_view text, int pointsize)
         {
-            std::unordered_map<int, int> counts;
-            for (const auto &ch : chars)
+            const auto limited_word_bbox = limit_to_line_height(line_bbox, word_bbox);
+            const auto limited_char_bbox = limit_to_line_height(line_bbox, char_bbox);
+
+            if (lines().empty() || line_bbox != lines().back().bbox)
+            {
+                push_line(line_bbox);
+            }
+            if (lines().back().word_begin == lines().back().word_end || limited_word_bbox != words().back().bbox)
             {
-                counts[ch.bbox.y0]++;
+                push_word(limited_word_bbox);
             }
-            auto y0 = std::max_element(counts.cbegin(), counts.cend(), [](const auto &lhs, const auto &rhs)
-                                       { return lhs.second < rhs.second; })
-                          ->first;
-            counts.clear();
+            push_char(limited_char_bbox, text, pointsize);
+        }
 
-            for (const auto &ch : chars)
+        // 追加另一页的全部行，例如合并分块识别的结果
+        void append(const Page &other)
+        {
+            if (other.empty())
             {
-                counts[ch.bbox.y1]++;
+                return;
             }
-            auto y1 = std::max_element(counts.cbegin(), counts.cend(), [](const auto &lhs, const auto &rhs)
-                                       { return lhs.second < rhs.second; })
-                          ->first;
+            auto &s = storage(other.content_size());
+            const auto word_base = static_cast<uint32_t>(s.words.size());
+            const auto char_base = static_cast<uint32_t>(s.chars.size());
+            const auto text_base = static_cast<uint32_t>(s.text.size());
 
-            for (auto &ch : chars)
+            s.lines.reserve(s.lines.size() + other.lines().size());
+            for (auto line : other.lines())
             {
-                ch.pointsize = y1 - y0;
-                ch.bbox = ch.bbox.clip_y(y0, y1);
+                line.word_begin += word_base;
+                line.word_end += word_base;
+                s.lines.push_back(line);
+            }
+            s.words.reserve(s.words.size() + other.words().size());
+            for (auto word : other.words())
+            {
+                word.char_begin += char_base;
+                word.char_end += char_base;
+                s.words.push_back(word);
+            }
+            s.chars.reserve(s.chars.size() + other.chars().size());
+            for (auto ch : other.chars())
+            {
+                ch.text_offset += text_base;
+                s.chars.push_back(ch);
             }
-            bbox = bbox.clip_y(y0, y1);
+            s.text += other.text();
         }
 
-        void draw(cv::Ptr<cv::freetype::FreeType2> &ft2, cv::Mat &bitmap) const
+        // 追加另一页中的一行，连同它的词和字
+        void append_line(const Page &other, const Line &line)
         {
-            // println("{} bbox: {}", __func__, bbox.to_string());
-            cv::rectangle(bitmap, cv::Point(bbox.x0, bbox.y0), cv::Point(bbox.x1, bbox.y1), CV_COLOR_GREEN, 2, cv::LINE_8, 0);
-            for (const auto &ch : chars)
+            push_line(line.bbox);
+            for (const auto &word : other.words_of(line))
             {
-                ch.draw(ft2, bitmap);
+                push_word(word.bbox);
+                for (const auto &ch : other.chars_of(word))
+                {
+                    push_char(ch.bbox, other.text_of(ch), ch.pointsize);
+                }
             }
         }
 
-        Word operator|(const Word &rhs) const
+        // 对所有行、词、字的包围盒做同一个坐标变换，例如从归一化图像映射回原图
+        template <typename F>
+        void map_boxes(F &&f)
         {
-            Word lhs = *this;
-            lhs.bbox |= rhs.bbox;
-            lhs.chars.insert(lhs.chars.end(), rhs.chars.begin(), rhs.chars.end());
-            return lhs;
+            if (!m_storage)
+            {
+                return;
+            }
+            for (auto &line : m_storage->lines)
+            {
+                line.bbox = f(line.bbox);
+            }
+            for (auto &word : m_storage->words)
+            {
+                word.bbox = f(word.bbox);
+            }
+            for (auto &ch : m_storage->chars)
+            {
+                ch.bbox = f(ch.bbox);
+            }
         }
 
-        Word &operator|=(const Word &rhs)
+        void draw(GlyphCache &glyphs, cv::Mat &bitmap) const
         {
-            bbox |= rhs.bbox;
-            chars.insert(chars.end(), rhs.chars.begin(), rhs.chars.end());
-            return *this;
+            for (const auto &line : lines())
+            {
+                // println("{} bbox: {}", __func__, line.bbox.to_string());
+                cv::rectangle(bitmap, cv::Point(line.bbox.x0, line.bbox.y0), cv::Point(line.bbox.x1, line.bbox.y1), CV_COLOR_YELLOW, 2, cv::LINE_AA, 0);
+                for (const auto &word : words_of(line))
+                {
+                    cv::rectangle(bitmap, cv::Point(word.bbox.x0, word.bbox.y0), cv::Point(word.bbox.x1, word.bbox.y1), CV_COLOR_GREEN, 2, cv::LINE_8, 0);
+                    for (const auto &ch : chars_of(word))
+                    {
+                        draw_char(glyphs, bitmap, ch);
+                    }
+                }
+            }
         }
-    };
 
-    struct Line
-    {
-        Rect bbox;
-        std::vector<Word> words;
+        void draw_char(GlyphCache &glyphs, cv::Mat &bitmap, const Char &ch) const
+        {
+            const auto &bbox = ch.bbox;
+            const auto text = text_of(ch);
+            const auto baseline = glyphs.baseline(text, bbox.height());
+            glyphs.put_text(bitmap, text, cv::Point(bbox.x0, bbox.y0 + baseline), bbox.height(), CV_COLOR_BLACK);
+            cv::rectangle(bitmap, cv::Point(bbox.x0, bbox.y0), cv::Point(bbox.x1, bbox.y1), CV_COLOR_RED, 1, cv::LINE_4, 0);
+        }
 
-        void draw(cv::Ptr<cv::freetype::FreeType2> &ft2, cv::Mat &bitmap) const
+        // threads 为参与的线程数 (包括调用线程)，不大于 1 时串行
+        void reflow(size_t threads = 1)
         {
-            // println("{} bbox: {}", __func__, bbox.to_string());
-            cv::rectangle(bitmap, cv::Point(bbox.x0, bbox.y0), cv::Point(bbox.x1, bbox.y1), CV_COLOR_YELLOW, 2, cv::LINE_AA, 0);
-            for (const auto &word : words)
-            {
-                word.draw(ft2, bitmap);
-            }
+            reflow_words(threads);
+            reflow_lines(threads);
         }
 
-        void reflow(bool recursive = false)
+        // 逐词收紧字宽，并按词内最常见的上下边统一字高
+        void reflow_words(size_t threads = 1)
         {
-            std::vector<Word> new_words;
-            new_words.reserve(words.size());
+            for_each_line(threads, [&](Line &line)
+                          {
+                for (auto i = line.word_begin; i < line.word_end; ++i)
+                {
+                    reflow_word(m_storage->words[i]);
+                } });
+        }
 
-            if (recursive)
+        // 合并同一行中相邻的词：先在每行自己的词区间内原地合并 (按行并行)，再把各行的词依次前移压缩
+        void reflow_lines(size_t threads = 1)
+        {
+            if (!m_storage)
             {
-                words.front().reflow();
+                return;
             }
-            new_words.emplace_back(words.front());
+            auto &s = *m_storage;
+            for_each_line(threads, [&](Line &line)
+                          { line.word_end = merge_words(line); });
 
-            for (auto &&rhs : std::ranges::views::drop(words, 1))
+            uint32_t out = 0;
+            for (auto &line : s.lines)
             {
-                if (recursive)
+                const auto count = line.word_end - line.word_begin;
+                // out 不会超过 word_begin；相等时词已经在原位，std::copy 不允许目标与源重叠
+                if (out != line.word_begin)
                 {
-                    rhs.reflow();
-                }
-                auto &lhs = new_words.back();
-                const auto &lhs_char = lhs.chars.back();
-                const auto &rhs_char = rhs.chars.front();
-                if (lhs_char.bbox.x1 + lhs_char.bbox.height() >= rhs_char.bbox.x0)
-                { // nearby, merge them
-                    lhs |= rhs;
-                    lhs.resize();
-                }
-                else
-                { // faraway, keep split
-                    new_words.emplace_back(rhs);
+                    std::copy(s.words.begin() + line.word_begin, s.words.begin() + line.word_end, s.words.begin() + out);
                 }
+                line.word_begin = out;
+                line.word_end = out + count;
+                out += count;
             }
-
-            words = new_words;
+            s.words.resize(out);
         }
-    };
 
-    struct Page
-    {
-        std::vector<Line> m_lines;
+        // 字、词的高度超过行高时改用行的上下边
+        static Rect limit_to_line_height(const Rect &line_bbox, const Rect &bbox)
+        {
+            Rect fit_bbox = bbox;
+            if (bbox.height() > line_bbox.height())
+            {
+                fit_bbox.y0 = line_bbox.y0;
+                fit_bbox.y1 = line_bbox.y1;
+            }
+            return fit_bbox;
+        }
 
-        void append_char(const Rect &line_bbox, const Rect &word_bbox, const Rect &char_bbox, const std::string &text, int pointsize)
+    private:
+        struct Storage
         {
-            const auto limited_word_bbox = limit_to_line_height(line_bbox, word_bbox);
-            const auto limited_char_bbox = limit_to_line_height(line_bbox, char_bbox);
+            // 首块内存不需要清零，arena 只在其中分配
+            explicit Storage(size_t size) : buffer(std::make_unique_for_overwrite<std::byte[]>(size)),
+                                            arena(buffer.get(), size),
+                                            lines(&arena), words(&arena), chars(&arena), text(&arena)
+            {
+            }
 
-            if (m_lines.empty() || line_bbox != m_lines.back().bbox)
+            void reset()
             {
-                m_lines.emplace_back(Line{line_bbox});
+                // 先让容器放弃内存，再整体回收 arena
+                lines = std::pmr::vector<Line>(&arena);
+                words = std::pmr::vector<Word>(&arena);
+                chars = std::pmr::vector<Char>(&arena);
+                text = std::pmr::string(&arena);
+                arena.release();
             }
-            auto &line = m_lines.back();
 
-            if (line.words.empty() || limited_word_bbox != line.words.back().bbox)
+            std::unique_ptr<std::byte[]> buffer;
+            std::pmr::monotonic_buffer_resource arena;
+            std::pmr::vector<Line> lines;
+            std::pmr::vector<Word> words;
+            std::pmr::vector<Char> chars;
+            std::pmr::string text;
+        };
+
+        // size 只决定第一次创建时首块的大小，之后 arena 按需增长
+        Storage &storage(size_t size = arena_initial_size)
+        {
+            if (!m_storage)
             {
-                line.words.emplace_back(Word{limited_word_bbox});
+                m_storage = std::make_unique<Storage>(size);
             }
-            auto &word = line.words.back();
+            return *m_storage;
+        }
 
-            word.chars.emplace_back(Char{limited_char_bbox, text, pointsize});
+        // 装下本页全部内容所需的 arena 大小，每个数组留出对齐的余量
+        size_t content_size() const
+        {
+            return lines().size_bytes() + words().size_bytes() + chars().size_bytes() + text().size() + 1 + 4 * alignof(std::max_align_t);
         }
 
-        void draw(cv::Ptr<cv::freetype::FreeType2> &ft2, cv::Mat &bitmap) const
+        // 行数不少于 parallel_min_lines 的页面按行并行，每一行只访问自己的词和字，互不重叠
+        // 线程数由调用方给出 (--threads)，每个线程至少分到 parallel_min_lines / 2 行
+        static constexpr size_t parallel_min_lines = 64;
+
+        template <typename F>
+        void for_each_line(size_t threads, F &&f)
         {
-            for (const auto &line : m_lines)
+            if (!m_storage)
+            {
+                return;
+            }
+            auto &lines = m_storage->lines;
+            const auto num_workers = std::min<size_t>(threads, lines.size() / (parallel_min_lines / 2));
+            if (lines.size() < parallel_min_lines || num_workers <= 1)
             {
-                line.draw(ft2, bitmap);
+                for (auto &line : lines)
+                {
+                    f(line);
+                }
+                return;
             }
+
+            std::atomic_size_t next_index{0};
+            const auto worker = [&]
+            {
+                for (auto i = next_index++; i < lines.size(); i = next_index++)
+                {
+                    f(lines[i]);
+                }
+            };
+            std::vector<std::jthread> workers;
+            workers.reserve(num_workers - 1);
+            for (size_t w = 1; w < num_workers; ++w)
+            {
+                workers.emplace_back(worker);
+            }
+            worker();
         }
 
-        void reflow()
+        // 在行自己的词区间内原地合并相邻的词，返回新的 word_end
+        uint32_t merge_words(const Line &line)
         {
-            for (auto &line : m_lines)
+            auto &s = *m_storage;
+            auto out = line.word_begin;
+            for (auto i = line.word_begin; i < line.word_end; ++i)
             {
-                line.reflow(true);
+                const auto rhs = s.words[i];
+                if (rhs.char_begin == rhs.char_end)
+                {
+                    continue;
+                }
+                if (out > line.word_begin)
+                {
+                    auto &lhs = s.words[out - 1];
+                    const auto &lhs_char = s.chars[lhs.char_end - 1];
+                    const auto &rhs_char = s.chars[rhs.char_begin];
+                    if (lhs_char.bbox.x1 + lhs_char.bbox.height() >= rhs_char.bbox.x0)
+                    { // nearby, merge them, their chars are adjacent
+                        lhs.bbox |= rhs.bbox;
+                        lhs.char_end = rhs.char_end;
+                        resize_word(lhs);
+                        continue;
+                    }
+                }
+                // faraway, keep split
+                s.words[out++] = rhs;
             }
+            return out;
         }
 
-    private:
-        static Rect limit_to_line_height(const Rect &line_bbox, const Rect &bbox)
+        void reflow_word(Word &word)
         {
-            Rect fit_bbox = bbox;
-            if (bbox.height() > line_bbox.height())
+            if (word.char_begin == word.char_end)
             {
-                fit_bbox.y0 = line_bbox.y0;
-                fit_bbox.y1 = line_bbox.y1;
+                return;
             }
-            return fit_bbox;
+            auto &chars = m_storage->chars;
+            Rect bbox;
+            for (auto i = word.char_begin; i < word.char_end; ++i)
+            {
+                auto &ch = chars[i];
+                // limit the width of the character to fit the height of the character
+                auto x1 = ch.bbox.x0 + ch.bbox.height() * 6 / 5;
+                if (i + 1 < word.char_end)
+                {
+                    x1 = std::min(x1, chars[i + 1].bbox.x0 - 1);
+                }
+                ch.bbox = ch.bbox.clip_left(x1);
+                bbox |= ch.bbox;
+            }
+            word.bbox = bbox;
+            resize_word(word);
         }
-    };
-}
 
-namespace std
-{
-    template <>
-    struct hash<fixed2_debugger::Char>
-    {
-        size_t operator()(const fixed2_debugger::Char &info) const
+        void resize_word(Word &word)
         {
-            return std::hash<std::string>()(info.text);
+            auto chars = std::span(m_storage->chars).subspan(word.char_begin, word.char_end - word.char_begin);
+
+            // 每个线程一个复用的缓冲区，排序后取最长的一段作为众数，出现次数相同时取较小的值
+            thread_local std::vector<int> edges;
+            const auto mode = [&](auto &&edge)
+            {
+                edges.clear();
+                for (const auto &ch : chars)
+                {
+                    edges.push_back(edge(ch.bbox));
+                }
+                std::ranges::sort(edges);
+                int best = edges.front();
+                size_t best_count = 0;
+                for (size_t i = 0, j = 0; i < edges.size(); i = j)
+                {
+                    for (j = i + 1; j < edges.size() && edges[j] == edges[i]; ++j)
+                    {
+                    }
+                    if (j - i > best_count)
+                    {
+                        best = edges[i];
+                        best_count = j - i;
+                    }
+                }
+                return best;
+            };
+            const auto y0 = mode([](const Rect &r)
+                                 { return r.y0; });
+            const auto y1 = mode([](const Rect &r)
+                                 { return r.y1; });
+
+            for (auto &ch : chars)
+            {
+                ch.pointsize = y1 - y0;
+                ch.bbox = ch.bbox.clip_y(y0, y1);
+            }
+            word.bbox = word.bbox.clip_y(y0, y1);
         }
-    };
 
+        std::unique_ptr<Storage> m_storage;
+    };
 }
 
 namespace fixed2_debugger
@@ -263,67 +512,84 @@ namespace fixed2_debugger
     public:
         Debugger(const Args &args) : m_args(args)
         {
-            m_ft2 = cv::freetype::createFreeType2();
-            m_ft2->loadFontData(m_args.font, 0);
+            if (!enabled())
+            {
+                return;
+            }
+            m_glyphs = std::make_shared<GlyphCache>(m_args.font);
+        }
+
+        // 复用调用方的字形缓存，例如批处理中每个 worker 各自持有一个
+        Debugger(const Args &args, std::shared_ptr<GlyphCache> glyphs) : m_args(args), m_glyphs(std::move(glyphs))
+        {
         }
 
-        void set_image(const std::string &image_path)
+        bool enabled() const
         {
-            m_image_path = image_path;
+            return m_args.debug(DebugResult);
+        }
+
+        void set_image(const ImagePtr &image)
+        {
+            m_image = image;
+            m_debug_stem = image->debug_stem();
+        }
+
+        void set_page(const Page &page)
+        {
+            m_page = page;
         }
 
         ~Debugger()
         {
-            dump(std::filesystem::path(m_image_path).filename().replace_extension(".fixed2.png"));
+            if (!enabled())
+            {
+                return;
+            }
+            dump(m_debug_stem + ".fixed2.png");
             reflow();
         }
 
-        void on_char(const Rect &line_bbox, const Rect &word_bbox, const Rect &char_bbox, const std::string &text, int pointsize)
+        void on_char(const Rect &line_bbox, const Rect &word_bbox, const Rect &char_bbox, std::string_view text, int pointsize)
         {
+            if (!enabled())
+            {
+                return;
+            }
             m_page.append_char(line_bbox, word_bbox, char_bbox, text, pointsize);
         }
 
         void dump(const std::filesystem::path &filepath)
         {
-            auto bitmap = cv::imread(m_image_path, cv::IMREAD_COLOR);
-            bitmap = CV_COLOR_WHITE;
-            m_page.draw(m_ft2, bitmap);
-            cv::imwrite(filepath.generic_string(), bitmap);
+            if (!m_image)
+            {
+                return;
+            }
+            auto bitmap = m_image->canvas(CV_COLOR_WHITE);
+            m_page.draw(*m_glyphs, bitmap);
+            DebugWriter::instance().write(filepath.generic_string(), std::move(bitmap));
         }
 
         void reflow()
         {
 #if 1
             // reflow the words
-            for (auto &line : m_page.m_lines)
-            {
-                for (auto &word : line.words)
-                {
-                    word.reflow();
-                }
-            }
-            auto filepath1 = std::filesystem::path(m_image_path);
-            filepath1.replace_extension(".fixed2_reflow_words.png");
-            dump(filepath1.filename());
+            m_page.reflow_words(m_args.threads);
+            dump(m_debug_stem + ".fixed2_reflow_words.png");
             // reflow the lines
-            for (auto &line : m_page.m_lines)
-            {
-                line.reflow(false);
-            }
-            auto filepath2 = std::filesystem::path(m_image_path);
-            filepath2.replace_extension(".fixed2_reflow_lines.png");
-            dump(filepath2.filename());
+            m_page.reflow_lines(m_args.threads);
+            dump(m_debug_stem + ".fixed2_reflow_lines.png");
 #else
-            m_page.reflow();
-            filepath.replace_extension(".fixed2_reflow.png");
-            dump(filepath.filename());
+            m_page.reflow(m_args.threads);
+            dump(m_debug_stem + ".fixed2_reflow.png");
 #endif
         }
 
     private:
         Args m_args;
-        std::string m_image_path;
-        cv::Ptr<cv::freetype::FreeType2> m_ft2;
+        ImagePtr m_image;
+        std::string m_debug_stem;
+        std::shared_ptr<GlyphCache> m_glyphs;
         Page m_page;
     };
 }
\ No newline at end of file
@@ -3,18 +3,19 @@
 #include <memory>
 #include <string>
 #include <print>
-#include <unordered_map>
-#include <filesystem>
 
 #include "args.h"
 #include "common.h"
+#include "debug_writer.h"
+#include "flat_hash.h"
+#include "glyph_cache.h"
+#include "image.h"
 
 #include <leptonica/allheaders.h>
 
 #include <opencv4/opencv2/opencv.hpp>
 #include <opencv4/opencv2/imgproc.hpp>
 #include <opencv4/opencv2/imgcodecs.hpp>
-#include <opencv4/opencv2/freetype.hpp>
 
 #define CV_COLOR_RED cv::Scalar(0, 0, 255)
 #define CV_COLOR_GREEN cv::Scalar(0, 255, 0)
@@ -42,13 +43,13 @@ namespace fixed_debugger
     struct Word
     {
         Rect bbox;
-        std::unordered_map<Rect, Char> chars;
+        FlatHashMap<Rect, Char> chars;
     };
 
     struct Line
     {
         Rect bbox;
-        std::unordered_map<Rect, Word> words;
+        FlatHashMap<Rect, Word> words;
     };
 
 }
@@ -60,7 +61,7 @@ namespace std
     {
         size_t operator()(const fixed_debugger::Char &info) const
         {
-            return std::hash<std::string>()(info.text);
+            return hash_glyph(info.text, info.bbox, info.pointsize);
         }
     };
 
@@ -74,15 +75,26 @@ namespace fixed_debugger
     public:
         Debugger(const Args &args) : m_args(args)
         {
-            m_ft2 = cv::freetype::createFreeType2();
-            m_ft2->loadFontData(m_args.font, 0);
+            if (!enabled())
+            {
+                return;
+            }
+            m_glyphs = std::make_shared<GlyphCache>(m_args.font);
         }
 
-        void set_image(const std::string &image_path)
+        bool enabled() const
         {
-            m_image_path = image_path;
-            m_bitmap = cv::imread(image_path, cv::IMREAD_COLOR);
-            m_bitmap = CV_COLOR_WHITE;
+            return m_args.debug(DebugResult);
+        }
+
+        void set_image(const ImagePtr &image)
+        {
+            if (!enabled())
+            {
+                return;
+            }
+            m_debug_stem = image->debug_stem();
+            m_bitmap = image->canvas(CV_COLOR_WHITE);
         }
 
         ~Debugger()
@@ -100,6 +112,10 @@ namespace fixed_debugger
 
         void on_char(const Rect &line_bbox, const Rect &word_bbox, const Rect &char_bbox, const std::string &text, int pointsize)
         {
+            if (!enabled())
+            {
+                return;
+            }
             auto fit_word_bbox = fit_line_bbox(line_bbox, word_bbox);
             auto fit_char_bbox = fit_line_bbox(line_bbox, char_bbox);
 
@@ -115,9 +131,8 @@ namespace fixed_debugger
 
         void putChineseText(const Char &ch, cv::Scalar color)
         {
-            int baseline = 0;
-            m_ft2->getTextSize(ch.text, ch.bbox.height(), -1, &baseline);
-            m_ft2->putText(m_bitmap, ch.text, cv::Point(ch.bbox.x0, ch.bbox.y0 + baseline), ch.bbox.height(), color, -1, cv::LINE_AA, false);
+            const auto baseline = m_glyphs->baseline(ch.text, ch.bbox.height());
+            m_glyphs->put_text(m_bitmap, ch.text, cv::Point(ch.bbox.x0, ch.bbox.y0 + baseline), ch.bbox.height(), color);
         }
 
         void flush_char(const Char &ch)
@@ -149,19 +164,23 @@ namespace fixed_debugger
 
         void flush()
         {
+            if (!enabled())
+            {
+                return;
+            }
             for (auto &[line_bbox, line] : m_lines)
             {
                 flush_line(line);
             }
             m_lines.clear();
-            cv::imwrite(std::format("{}.fixed_dbg.png", std::filesystem::path(m_image_path).filename().string()).c_str(), m_bitmap);
+            DebugWriter::instance().write(std::format("{}.fixed_dbg.png", m_debug_stem), std::exchange(m_bitmap, {}));
         }
 
     private:
         Args m_args;
-        std::string m_image_path;
-        cv::Ptr<cv::freetype::FreeType2> m_ft2;
+        std::string m_debug_stem;
+        std::shared_ptr<GlyphCache> m_glyphs;
         cv::Mat m_bitmap;
-        std::unordered_map<Rect, Line> m_lines;
+        FlatHashMap<Rect, Line> m_lines;
     };
 }
\ No newline at end of file
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// 64 位混合函数 (splitmix64 的收尾部分)，输入的每一位都会影响输出的每一位
+constexpr uint64_t hash_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// 顺序相关的组合，(a, b) 与 (b, a)、整体平移后的坐标都会得到不同的值
+constexpr size_t hash_combine(size_t seed, size_t value)
+{
+    return static_cast<size_t>(hash_mix(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2))));
+}
+
+// 开放寻址 (线性探测) 的哈希表：元素紧密存放在一个数组中，槽位数组只保存下标和哈希值，
+// 查找时先比较哈希值再比较键，删除时用后移法填补空洞，不留墓碑
+// 遍历按插入顺序进行 (删除会把最后一个元素移到被删除的位置)，插入或删除会使迭代器和引用失效
+template <typename Entry, typename Key, typename KeyOf, typename Hash, typename Eq>
+class _FlatHashTable
+{
+public:
+    using iterator = typename std::vector<Entry>::iterator;
+    using const_iterator = typename std::vector<Entry>::const_iterator;
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    bool empty() const
+    {
+        return m_entries.empty();
+    }
+
+    iterator begin() { return m_entries.begin(); }
+    iterator end() { return m_entries.end(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+    const_iterator cbegin() const { return m_entries.cbegin(); }
+    const_iterator cend() const { return m_entries.cend(); }
+
+    void clear()
+    {
+        m_entries.clear();
+        std::fill(m_slots.begin(), m_slots.end(), Slot{});
+    }
+
+    void reserve(size_t n)
+    {
+        m_entries.reserve(n);
+        if (n * 8 > m_slots.size() * 7)
+        {
+            rehash(capacity_for(n));
+        }
+    }
+
+    iterator find(const Key &key)
+    {
+        const auto slot = find_slot(key);
+        return slot ? m_entries.begin() + slot->index : m_entries.end();
+    }
+
+    const_iterator find(const Key &key) const
+    {
+        const auto slot = find_slot(key);
+        return slot ? m_entries.begin() + slot->index : m_entries.end();
+    }
+
+    bool contains(const Key &key) const
+    {
+        return find_slot(key) != nullptr;
+    }
+
+    size_t count(const Key &key) const
+    {
+        return contains(key) ? 1 : 0;
+    }
+
+    size_t erase(const Key &key)
+    {
+        if (m_slots.empty())
+        {
+            return 0;
+        }
+
+        const auto mask = m_slots.size() - 1;
+        auto hole = locate(key, hash_of(key));
+        if (m_slots[hole].index == Slot::empty)
+        {
+            return 0;
+        }
+        const auto index = m_slots[hole].index;
+
+        // 后移：把后面本应更靠前的槽位依次前移，保证探测链不断
+        for (auto next = (hole + 1) & mask; m_slots[next].index != Slot::empty; next = (next + 1) & mask)
+        {
+            const auto ideal = m_slots[next].hash & mask;
+            if (((next - ideal) & mask) >= ((next - hole) & mask))
+            {
+                m_slots[hole] = m_slots[next];
+                hole = next;
+            }
+        }
+        m_slots[hole] = Slot{};
+
+        // 用最后一个元素填补被删除的位置，并修正它的槽位
+        const auto last = static_cast<uint32_t>(m_entries.size() - 1);
+        if (index != last)
+        {
+            const auto &moved = KeyOf()(m_entries[last]);
+            m_slots[locate(moved, hash_of(moved))].index = index;
+            m_entries[index] = std::move(m_entries[last]);
+        }
+        m_entries.pop_back();
+        return 1;
+    }
+
+protected:
+    // 键不存在时用 make() 构造新元素，返回元素所在位置和是否新插入
+    template <typename Make>
+    std::pair<iterator, bool> insert_with(const Key &key, Make &&make)
+    {
+        if ((m_entries.size() + 1) * 8 > m_slots.size() * 7)
+        {
+            rehash(capacity_for(m_entries.size() + 1));
+        }
+
+        const auto hash = hash_of(key);
+        auto &slot = m_slots[locate(key, hash)];
+        if (slot.index != Slot::empty)
+        {
+            return {m_entries.begin() + slot.index, false};
+        }
+
+        m_entries.push_back(make());
+        slot = Slot{static_cast<uint32_t>(m_entries.size() - 1), hash};
+        return {m_entries.end() - 1, true};
+    }
+
+private:
+    struct Slot
+    {
+        static constexpr uint32_t empty = UINT32_MAX;
+
+        uint32_t index{empty};
+        uint32_t hash{};
+    };
+
+    // std::hash 对整数是恒等映射，这里再混合一次，低位才能用作槽位
+    uint32_t hash_of(const Key &key) const
+    {
+        return static_cast<uint32_t>(hash_mix(Hash()(key)));
+    }
+
+    // 返回键所在的槽位，不存在时返回应插入的空槽位；调用方保证槽位数组不为空
+    size_t locate(const Key &key, uint32_t hash) const
+    {
+        const auto mask = m_slots.size() - 1;
+        for (auto pos = hash & mask;; pos = (pos + 1) & mask)
+        {
+            const auto &slot = m_slots[pos];
+            if (slot.index == Slot::empty || (slot.hash == hash && Eq()(KeyOf()(m_entries[slot.index]), key)))
+            {
+                return pos;
+            }
+        }
+    }
+
+    const Slot *find_slot(const Key &key) const
+    {
+        if (m_entries.empty())
+        {
+            return nullptr;
+        }
+        const auto &slot = m_slots[locate(key, hash_of(key))];
+        return slot.index == Slot::empty ? nullptr : &slot;
+    }
+
+    static size_t capacity_for(size_t n)
+    {
+        size_t capacity = 16;
+        while (n * 8 > capacity * 7)
+        {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> slots(capacity);
+        const auto mask = capacity - 1;
+        for (const auto &slot : m_slots)
+        {
+            if (slot.index == Slot::empty)
+            {
+                continue;
+            }
+            auto pos = slot.hash & mask;
+            while (slots[pos].index != Slot::empty)
+            {
+                pos = (pos + 1) & mask;
+            }
+            slots[pos] = slot;
+        }
+        m_slots = std::move(slots);
+    }
+
+    std::vector<Entry> m_entries;
+    std::vector<Slot> m_slots;
+};
+
+namespace flat_hash_detail
+{
+    struct Identity
+    {
+        template <typename T>
+        const T &operator()(const T &value) const
+        {
+            return value;
+        }
+    };
+
+    struct First
+    {
+        template <typename P>
+        const auto &operator()(const P &pair) const
+        {
+            return pair.first;
+        }
+    };
+}
+
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class FlatHashMap : public _FlatHashTable<std::pair<K, V>, K, flat_hash_detail::First, Hash, Eq>
+{
+public:
+    template <typename... Args>
+    std::pair<typename FlatHashMap::iterator, bool> try_emplace(const K &key, Args &&...args)
+    {
+        return this->insert_with(key, [&]
+                                 { return std::pair<K, V>(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...)); });
+    }
+
+    std::pair<typename FlatHashMap::iterator, bool> insert(const std::pair<K, V> &entry)
+    {
+        return this->insert_with(entry.first, [&]
+                                 { return entry; });
+    }
+
+    V &operator[](const K &key)
+    {
+        return try_emplace(key).first->second;
+    }
+};
+
+template <typename K, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class FlatHashSet : public _FlatHashTable<K, K, flat_hash_detail::Identity, Hash, Eq>
+{
+public:
+    std::pair<typename FlatHashSet::iterator, bool> insert(const K &key)
+    {
+        return this->insert_with(key, [&]
+                                 { return key; });
+    }
+
+    std::pair<typename FlatHashSet::iterator, bool> insert(K &&key)
+    {
+        return this->insert_with(key, [&]
+                                 { return std::move(key); });
+    }
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <opencv2/opencv.hpp>
+
+// 字形光栅化缓存：同一页上的字形反复出现，且字号只有一两种，
+// 按 (码位, 像素高度) 缓存 FreeType 渲染出的 alpha 掩码，绘制时只做混合
+// FreeType 的 face 不是线程安全的，每个线程使用各自的 GlyphCache
+class GlyphCache
+{
+public:
+    struct Glyph
+    {
+        cv::Mat alpha; // CV_8UC1
+        int left{};    // 原点到位图左边的距离
+        int top{};     // 基线到位图上边的距离
+        int advance{};
+    };
+
+    explicit GlyphCache(const std::string &font_path, int face_index = 0)
+    {
+        if (FT_Init_FreeType(&m_library))
+        {
+            std::println(stderr, "Could not initialize FreeType.");
+            m_library = nullptr;
+            return;
+        }
+        if (FT_New_Face(m_library, font_path.c_str(), face_index, &m_face))
+        {
+            std::println(stderr, "Could not load font {}.", font_path);
+            m_face = nullptr;
+        }
+    }
+
+    GlyphCache(const GlyphCache &) = delete;
+    GlyphCache &operator=(const GlyphCache &) = delete;
+
+    ~GlyphCache()
+    {
+        if (m_face)
+        {
+            FT_Done_Face(m_face);
+        }
+        if (m_library)
+        {
+            FT_Done_FreeType(m_library);
+        }
+    }
+
+    bool loaded() const
+    {
+        return m_face != nullptr;
+    }
+
+    size_t size() const
+    {
+        return m_glyphs.size();
+    }
+
+    const Glyph &glyph(char32_t codepoint, int height)
+    {
+        const auto key = (static_cast<uint64_t>(codepoint) << 32) | static_cast<uint32_t>(height);
+        auto it = m_glyphs.find(key);
+        if (it != m_glyphs.end())
+        {
+            return it->second;
+        }
+
+        auto &glyph = m_glyphs[key];
+        if (!m_face)
+        {
+            return glyph;
+        }
+        if (m_height != height)
+        {
+            if (FT_Set_Pixel_Sizes(m_face, height, height))
+            {
+                return glyph;
+            }
+            m_height = height;
+        }
+        if (FT_Load_Char(m_face, codepoint, FT_LOAD_RENDER))
+        {
+            return glyph;
+        }
+
+        const auto slot = m_face->glyph;
+        const auto &bitmap = slot->bitmap;
+        glyph.left = slot->bitmap_left;
+        glyph.top = slot->bitmap_top;
+        glyph.advance = static_cast<int>(slot->advance.x >> 6);
+        // 拷贝一份，FreeType 的位图在下一次加载时会被覆盖
+        glyph.alpha = copy_bitmap(bitmap);
+        return glyph;
+    }
+
+    // FreeType 位图转成自上而下的 8 位 alpha 掩码 (CV_8UC1)。pitch 为负时位图是自下而上存放的：
+    // buffer 指向内存中的第一行，即最下面一行，最上面一行在 buffer + (rows - 1) * |pitch|，向下一行都是加 pitch
+    // 除了常见的 8 位灰度，内嵌点阵 (CJK 字体常见) 是每像素 1 位的 MONO，彩色字体是 BGRA，
+    // 一行的字节数各不相同，按像素格式逐行展开；不支持的格式返回空掩码
+    static cv::Mat copy_bitmap(const FT_Bitmap &bitmap)
+    {
+        cv::Mat alpha;
+        if (bitmap.rows == 0 || bitmap.width == 0)
+        {
+            return alpha;
+        }
+        const auto rows = static_cast<int>(bitmap.rows), width = static_cast<int>(bitmap.width);
+        const auto pitch = static_cast<ptrdiff_t>(bitmap.pitch);
+        const auto top = bitmap.buffer + (pitch < 0 ? -pitch * (rows - 1) : 0);
+        switch (bitmap.pixel_mode)
+        {
+        case FT_PIXEL_MODE_GRAY:
+            alpha.create(rows, width, CV_8UC1);
+            for (int row = 0; row < rows; ++row)
+            {
+                std::copy_n(top + row * pitch, width, alpha.ptr<uint8_t>(row));
+            }
+            break;
+        case FT_PIXEL_MODE_MONO:
+            // 每字节 8 个像素，最高位在左，0/1 放大到 0/255
+            alpha.create(rows, width, CV_8UC1);
+            for (int row = 0; row < rows; ++row)
+            {
+                const auto src = top + row * pitch;
+                const auto dst = alpha.ptr<uint8_t>(row);
+                for (int col = 0; col < width; ++col)
+                {
+                    dst[col] = (src[col >> 3] & (0x80 >> (col & 7))) ? 255 : 0;
+                }
+            }
+            break;
+        case FT_PIXEL_MODE_BGRA:
+            // 只取 alpha 通道，颜色由调用方指定
+            alpha.create(rows, width, CV_8UC1);
+            for (int row = 0; row < rows; ++row)
+            {
+                const auto src = top + row * pitch;
+                const auto dst = alpha.ptr<uint8_t>(row);
+                for (int col = 0; col < width; ++col)
+                {
+                    dst[col] = src[col * 4 + 3];
+                }
+            }
+            break;
+        default:
+            std::println(stderr, "Unsupported glyph pixel mode {}.", static_cast<int>(bitmap.pixel_mode));
+            break;
+        }
+        return alpha;
+    }
+
+    // 文本在基线以下的最大深度，对应 cv::freetype::FreeType2::getTextSize 的 baseline
+    int baseline(std::string_view text, int height)
+    {
+        int descent = 0;
+        if (!loaded() || height <= 0)
+        {
+            return descent;
+        }
+        for (size_t i = 0; i < text.size();)
+        {
+            const auto &g = glyph(next_codepoint(text, i), height);
+            descent = std::max(descent, g.alpha.rows - g.top);
+        }
+        return descent;
+    }
+
+    // 与 cv::freetype::FreeType2::putText(bottomLeftOrigin = false) 的定位一致：org 为文本的左上角
+    void put_text(cv::Mat &bitmap, std::string_view text, cv::Point org, int height, const cv::Scalar &color)
+    {
+        if (!loaded() || height <= 0 || bitmap.type() != CV_8UC3)
+        {
+            return;
+        }
+
+        const int baseline_y = org.y + height;
+        int x = org.x;
+        for (size_t i = 0; i < text.size();)
+        {
+            const auto &g = glyph(next_codepoint(text, i), height);
+            blend(bitmap, g, x + g.left, baseline_y - g.top, color);
+            x += g.advance;
+        }
+    }
+
+    static char32_t next_codepoint(std::string_view text, size_t &i)
+    {
+        const auto c = static_cast<uint8_t>(text[i++]);
+        int extra = 0;
+        char32_t codepoint = c;
+        if (c >= 0xF0)
+        {
+            extra = 3;
+            codepoint = c & 0x07;
+        }
+        else if (c >= 0xE0)
+        {
+            extra = 2;
+            codepoint = c & 0x0F;
+        }
+        else if (c >= 0xC0)
+        {
+            extra = 1;
+            codepoint = c & 0x1F;
+        }
+        for (; extra > 0 && i < text.size(); --extra)
+        {
+            codepoint = (codepoint << 6) | (static_cast<uint8_t>(text[i++]) & 0x3F);
+        }
+        return codepoint;
+    }
+
+    // 把字形的 alpha 掩码以 (x0, y0) 为左上角混合到 CV_8UC3 的 bitmap 上，超出 bitmap 的部分被裁掉
+    static void blend(cv::Mat &bitmap, const Glyph &g, int x0, int y0, const cv::Scalar &color)
+    {
+        const auto row_begin = std::max(0, -y0);
+        const auto row_end = std::min(g.alpha.rows, bitmap.rows - y0);
+        const auto col_begin = std::max(0, -x0);
+        const auto col_end = std::min(g.alpha.cols, bitmap.cols - x0);
+        for (int row = row_begin; row < row_end; ++row)
+        {
+            // 指针从裁剪后的第一列开始，不构造指向行首之前的指针
+            const auto src = g.alpha.ptr<uint8_t>(row) + col_begin;
+            auto dst = bitmap.ptr<cv::Vec3b>(y0 + row) + (x0 + col_begin);
+            for (int col = 0; col < col_end - col_begin; ++col)
+            {
+                const int a = src[col];
+                if (a == 0)
+                {
+                    continue;
+                }
+                for (int c = 0; c < 3; ++c)
+                {
+                    dst[col][c] = static_cast<uint8_t>((color[c] * a + dst[col][c] * (255 - a)) / 255);
+                }
+            }
+        }
+    }
+
+private:
+
+    FT_Library m_library{};
+    FT_Face m_face{};
+    int m_height{-1};
+    std::unordered_map<uint64_t, Glyph> m_glyphs;
+};
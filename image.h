@@ -0,0 +1,148 @@
+#pragma once
+
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <string>
+#include <print>
+
+#include "common.h"
+#include "mapped_file.h"
+
+#include <leptonica/allheaders.h>
+
+#include <opencv2/opencv.hpp>
+
+// 解码一次的图像，识别和各个调试渲染器共享同一份像素
+// 文件只映射一次，从映射的内存解码，编码数据 (file) 同样由各个使用者共享，不需要再按路径打开
+struct Image
+{
+    std::string path;
+    std::shared_ptr<const MappedFile> file;
+    int page{}; // 多页文件中的页码，从 0 开始
+    int width{};
+    int height{};
+    int depth{};
+    std::shared_ptr<Pix> pix;
+    PixMat mat; // pix 的 cv::Mat 视图，供 OpenCV 的各个阶段使用
+
+    // 调试输出的文件名前缀：文件名去掉扩展名后加上页码，多页文件的各页不会互相覆盖
+    std::string debug_stem() const
+    {
+        return std::format("{}.p{}", std::filesystem::path(path).stem().string(), page);
+    }
+
+    // 与图像同尺寸的纯色画布，调试渲染只需要尺寸，不需要再次解码
+    cv::Mat canvas(const cv::Scalar &color = cv::Scalar(255, 255, 255)) const
+    {
+        return cv::Mat(height, width, CV_8UC3, color);
+    }
+
+    // 返回的 cv::Mat 可能直接引用本图像的像素，不能比 Image 活得更久
+    cv::Mat gray() const
+    {
+        return mat.gray();
+    }
+
+    cv::Mat bgr() const
+    {
+        return mat.bgr();
+    }
+
+    static std::shared_ptr<const Image> read(const std::string &path)
+    {
+        return decode(MappedFile::open(path), path);
+    }
+
+    // 从内存中的编码数据解码，path 只用于日志和调试输出的文件名；
+    // 管道或套接字收到的图片用 MappedFile::from_buffer 包装后传入，不需要临时文件
+    static std::shared_ptr<const Image> decode(std::shared_ptr<const MappedFile> file, const std::string &path)
+    {
+        if (!file)
+        {
+            return nullptr;
+        }
+        auto pix = PixMat::own(pixReadMem(bytes(*file), file->size()));
+        if (!pix)
+        {
+            std::println(stderr, "Could not read image {}.", path);
+            return nullptr;
+        }
+
+        return from_pix(path, std::move(pix), 0, std::move(file));
+    }
+
+    static std::shared_ptr<const Image> from_pix(const std::string &path, std::shared_ptr<Pix> pix, int page = 0, std::shared_ptr<const MappedFile> file = nullptr)
+    {
+        auto image = std::make_shared<Image>();
+        image->path = path;
+        image->file = std::move(file);
+        image->page = page;
+        image->pix = std::move(pix);
+        if (pixGetDimensions(image->pix.get(), &image->width, &image->height, &image->depth))
+        {
+            std::println(stderr, "Could not get image dimensions.");
+            return nullptr;
+        }
+        image->mat = PixMat::wrap(image->pix);
+        return image;
+    }
+
+    static const l_uint8 *bytes(const MappedFile &file)
+    {
+        return reinterpret_cast<const l_uint8 *>(file.data());
+    }
+};
+
+using ImagePtr = std::shared_ptr<const Image>;
+
+// 逐页解码一个图像文件：文件只映射一次，多页 TIFF 每次从映射中解码一页，通过目录偏移定位下一页，
+// 解码后的像素不会同时驻留在内存中；其它格式只有一页
+class PageReader
+{
+public:
+    explicit PageReader(std::string path) : PageReader(MappedFile::open(path), std::move(path))
+    {
+    }
+
+    PageReader(std::shared_ptr<const MappedFile> file, std::string path) : m_path(std::move(path)), m_file(std::move(file))
+    {
+        // findFileFormatBuffer 至少需要 12 个字节
+        l_int32 format = IFF_UNKNOWN;
+        m_done = !m_file;
+        m_tiff = m_file && m_file->size() >= 12 && !findFileFormatBuffer(Image::bytes(*m_file), &format) && L_FORMAT_IS_TIFF(format);
+    }
+
+    // 下一页，读完或解码失败时返回 nullptr
+    ImagePtr next()
+    {
+        if (m_done)
+        {
+            return nullptr;
+        }
+        if (!m_tiff)
+        {
+            m_done = true;
+            return Image::decode(m_file, m_path);
+        }
+
+        // 返回后 m_offset 指向下一页的目录，最后一页之后为 0
+        auto pix = PixMat::own(pixReadMemFromMultipageTiff(Image::bytes(*m_file), m_file->size(), &m_offset));
+        m_done = m_offset == 0;
+        if (!pix)
+        {
+            std::println(stderr, "Could not read page {} of {}.", m_page, m_path);
+            m_done = true;
+            return nullptr;
+        }
+        return Image::from_pix(m_path, std::move(pix), m_page++, m_file);
+    }
+
+private:
+    std::string m_path;
+    std::shared_ptr<const MappedFile> m_file;
+    bool m_tiff{};
+    bool m_done{};
+    size_t m_offset{};
+    int m_page{};
+};
@@ -1,4 +1,7 @@
+#include "archive.h"
 #include "args.h"
+#include "bench.h"
+#include "pipeline.h"
 #include "recognise.h"
 #include "test_ocr.h"
 
@@ -7,14 +10,73 @@ int main(int argc, char **argv)
     const auto args = Args::from(argc, argv);
     args.print();
 
+    if (!args.bench.empty())
+    {
+        return Bench::run(args);
+    }
+
+    if (args.streaming)
+    {
+        return Pipeline::run(args) ? 0 : 1;
+    }
+
+    if (args.threads > 0)
+    {
+        const auto images = Recognise::batch_recognise(args);
+        if (!images)
+        {
+            return 1;
+        }
+        if (!args.archive.empty())
+        {
+            archive::Writer writer(args.archive);
+            if (!writer)
+            {
+                return 1;
+            }
+            for (const auto &pages : *images)
+            {
+                for (const auto &[page_number, page] : std::ranges::views::enumerate(pages))
+                {
+                    writer.append(page, static_cast<uint32_t>(page_number));
+                }
+            }
+            if (!writer)
+            {
+                std::println(stderr, "Could not write archive {}.", args.archive);
+                writer.discard();
+                return 1;
+            }
+        }
+        return 0;
+    }
+
     // Recognise::ocr_recognise(args);
     // Recognise::tables_recognise(args);
 
     // auto page = Recognise::texts_recognise(args.images.front(), args);
-    fixed2_debugger::Page page;
-    auto segments = Recognise::segments_recognise(args.images.front(), args);
+    if (args.images.empty())
+    {
+        std::println(stderr, "No images given.");
+        return 1;
+    }
+
+    // 多页文件逐页处理；每页只解码一次，识别和线段检测共享同一个 PageContext 中的中间结果
+    PageReader reader(args.images.front());
+    auto image = reader.next();
+    if (!image)
+    {
+        return 1;
+    }
+    for (; image; image = reader.next())
+    {
+        std::println("{} page {}", image->path, image->page + 1);
+        PageContext context(image);
+        const auto page = Recognise::texts_recognise(context, args);
+        const auto &segments = Recognise::segments_recognise(context, args);
 
-    Recognise::filter_segments(segments, page, args.images.front());
+        Recognise::tables_from_segments(segments, page, args.debug(DebugResult) ? &context : nullptr);
+    }
 
     // test_ocr(args.images.front(), args.tessdata, args.lang);
     return 0;
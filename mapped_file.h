@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <print>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 只读内存映射文件，多个使用者通过 shared_ptr 共享同一个映射
+// 管道、套接字等不能映射的文件一次性读入内存，使用方式与映射相同
+class MappedFile
+{
+public:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (m_mapped)
+        {
+            munmap(m_data, m_size);
+        }
+    }
+
+    // 接管已经在内存中的数据，例如从套接字收到的图片
+    static std::shared_ptr<const MappedFile> from_buffer(std::vector<std::byte> buffer)
+    {
+        auto file = std::shared_ptr<MappedFile>(new MappedFile());
+        file->m_buffer = std::move(buffer);
+        file->m_data = file->m_buffer.data();
+        file->m_size = file->m_buffer.size();
+        return file;
+    }
+
+    static std::shared_ptr<const MappedFile> open(const std::string &path)
+    {
+        const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            std::println(stderr, "Could not open {}.", path);
+            return nullptr;
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0)
+        {
+            std::println(stderr, "Could not stat {}.", path);
+            ::close(fd);
+            return nullptr;
+        }
+
+        if (!S_ISREG(st.st_mode))
+        {
+            auto file = read_all(fd, path);
+            ::close(fd);
+            return file;
+        }
+
+        auto file = std::shared_ptr<MappedFile>(new MappedFile());
+        file->m_size = static_cast<size_t>(st.st_size);
+        if (file->m_size > 0)
+        {
+            auto data = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                std::println(stderr, "Could not mmap {}.", path);
+                ::close(fd);
+                return nullptr;
+            }
+            file->m_data = data;
+            file->m_mapped = true;
+        }
+        // 映射建立之后文件描述符就不再需要了
+        ::close(fd);
+        return file;
+    }
+
+    const std::byte *data() const
+    {
+        return static_cast<const std::byte *>(m_data);
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    std::span<const std::byte> bytes() const
+    {
+        return {data(), m_size};
+    }
+
+private:
+    MappedFile() = default;
+
+    static std::shared_ptr<const MappedFile> read_all(int fd, const std::string &path)
+    {
+        constexpr size_t chunk = 64 * 1024;
+        std::vector<std::byte> buffer;
+        while (true)
+        {
+            const auto size = buffer.size();
+            buffer.resize(size + chunk);
+            const auto n = ::read(fd, buffer.data() + size, chunk);
+            if (n < 0 && errno == EINTR)
+            {
+                buffer.resize(size);
+                continue;
+            }
+            if (n < 0)
+            {
+                std::println(stderr, "Could not read {}.", path);
+                return nullptr;
+            }
+            buffer.resize(size + static_cast<size_t>(n));
+            if (n == 0)
+            {
+                break;
+            }
+        }
+        return from_buffer(std::move(buffer));
+    }
+
+    void *m_data{};
+    size_t m_size{};
+    bool m_mapped{};
+    std::vector<std::byte> m_buffer; // 不能映射时数据读入这里
+};
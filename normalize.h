@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <print>
+
+#include "args.h"
+#include "common.h"
+#include "image.h"
+#include "page_context.h"
+
+#include <leptonica/allheaders.h>
+
+// 识别前的图像归一化：转成 8 位灰度、把高分辨率的扫描件缩小到 --dpi、纠正倾斜
+// 识别在归一化后的图像上进行，Transform 记录了这一变换，用于把识别结果映射回原图坐标
+class Normalize
+{
+public:
+    // 原图坐标 p 经过 p * scale 缩放，再绕缩放后图像的中心按 pixRotate 的约定旋转 angle (弧度，顺时针为正)
+    struct Transform
+    {
+        double scale{1.0};
+        double angle{};
+        int width{};  // 原图尺寸，映射回去的矩形裁剪到原图内
+        int height{};
+        double center_x{}; // 旋转中心，pixRotate 使用 (w / 2, h / 2)
+        double center_y{};
+
+        bool identity() const
+        {
+            return scale == 1.0 && angle == 0.0;
+        }
+
+        // 归一化图像中的矩形在原图中的包围盒：四个角逆旋转、逆缩放后取包围盒
+        Rect to_original(const Rect &rect) const
+        {
+            if (identity() || rect.is_empty())
+            {
+                return rect;
+            }
+
+            const auto cos_a = std::cos(angle), sin_a = std::sin(angle);
+            auto x0 = static_cast<double>(width), y0 = static_cast<double>(height), x1 = 0.0, y1 = 0.0;
+            for (const auto x : {rect.x0, rect.x1})
+            {
+                for (const auto y : {rect.y0, rect.y1})
+                {
+                    // 与 pixRotateAMGray 从目标像素反求源像素的公式相同
+                    const auto dx = x - center_x, dy = y - center_y;
+                    const auto sx = (center_x + dx * cos_a + dy * sin_a) / scale;
+                    const auto sy = (center_y - dx * sin_a + dy * cos_a) / scale;
+                    x0 = std::min(x0, sx);
+                    y0 = std::min(y0, sy);
+                    x1 = std::max(x1, sx);
+                    y1 = std::max(y1, sy);
+                }
+            }
+            return Rect{static_cast<int>(std::floor(x0)), static_cast<int>(std::floor(y0)),
+                        static_cast<int>(std::ceil(x1)), static_cast<int>(std::ceil(y1))} &
+                   Rect{0, 0, width, height};
+        }
+    };
+
+    struct Normalized
+    {
+        ImagePtr image;
+        Transform transform;
+    };
+
+    // 与 Leptonica pixDeskew 的默认阈值相同：置信度太低或角度太小时不旋转
+    static constexpr float min_skew_confidence = 3.0f;
+    static constexpr float min_skew_degrees = 0.1f;
+
+    // 灰度图取自 context 的缓存，与线段检测共用同一次转换，这里只拷贝成 Pix
+    static Normalized run(PageContext &context, const Args &args)
+    {
+        const auto &gray = context.gray();
+        return run(context.image(), gray.empty() ? nullptr : PixMat::from(gray), args);
+    }
+
+    static Normalized run(const ImagePtr &image, const Args &args)
+    {
+        // 结果是新的 Pix，之后设置分辨率不会影响共享的原图
+        auto gray = PixMat::own(pixConvertTo8(image->pix.get(), 0));
+        if (gray.get() == image->pix.get())
+        {
+            gray = PixMat::own(pixCopy(nullptr, image->pix.get()));
+        }
+        return run(image, std::move(gray), args);
+    }
+
+private:
+    // gray 为原图的 8 位灰度拷贝，归一化在它上面进行
+    static Normalized run(const ImagePtr &image, std::shared_ptr<Pix> gray, const Args &args)
+    {
+        Normalized result{nullptr, {1.0, 0.0, image->width, image->height}};
+        auto &transform = result.transform;
+        const auto source = image->pix.get();
+        if (!gray)
+        {
+            std::println(stderr, "Could not convert image to grayscale.");
+            return result;
+        }
+
+        // 未知分辨率按 --dpi (或 300) 处理；高于 --dpi 的缩小到 --dpi，不放大
+        l_int32 xres = 0, yres = 0;
+        pixGetResolution(source, &xres, &yres);
+        const auto target = args.dpi > 0 ? args.dpi : default_dpi;
+        auto resolution = xres > 0 ? xres : target;
+        if (args.dpi > 0 && xres > args.dpi)
+        {
+            transform.scale = static_cast<double>(args.dpi) / xres;
+            if (auto scaled = PixMat::own(pixScale(gray.get(), static_cast<float>(transform.scale), static_cast<float>(transform.scale))))
+            {
+                gray = std::move(scaled);
+                resolution = args.dpi;
+            }
+            else
+            {
+                transform.scale = 1.0;
+            }
+        }
+
+        // 在缩小后的图像上估计倾斜角，开销与原图大小无关
+        if (args.deskew)
+        {
+            l_float32 degrees = 0, confidence = 0;
+            const auto binary = PixMat::own(pixConvertTo1(gray.get(), 130));
+            if (binary && !pixFindSkew(binary.get(), &degrees, &confidence) &&
+                confidence >= min_skew_confidence && std::abs(degrees) >= min_skew_degrees)
+            {
+                const auto radians = degrees * std::numbers::pi / 180.0;
+                if (auto rotated = PixMat::own(pixRotate(gray.get(), static_cast<float>(radians), L_ROTATE_AREA_MAP, L_BRING_IN_WHITE, 0, 0)))
+                {
+                    gray = std::move(rotated);
+                    transform.angle = radians;
+                }
+            }
+        }
+
+        transform.center_x = pixGetWidth(gray.get()) / 2;
+        transform.center_y = pixGetHeight(gray.get()) / 2;
+
+        // Tesseract 在 SetImage 时读取分辨率，必须在此之前设置
+        pixSetResolution(gray.get(), resolution, resolution);
+        if (args.debug(DebugIntermediate))
+        {
+            std::println(stderr, "normalize: {}x{} {}dpi -> {}x{} {}dpi, skew: {:.2f}",
+                         image->width, image->height, xres, pixGetWidth(gray.get()), pixGetHeight(gray.get()), resolution,
+                         transform.angle * 180.0 / std::numbers::pi);
+        }
+
+        result.image = Image::from_pix(image->path, std::move(gray), image->page, image->file);
+        return result;
+    }
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "image.h"
+
+#include <opencv2/opencv.hpp>
+
+// 一张图片在各个识别阶段之间共享的中间结果：灰度、模糊、边缘、二值图、Hough 线段，
+// 每一项在第一次使用时计算并缓存，同一张图片上不同的阶段不会重复计算
+// 不是线程安全的，同一时刻只能由一个阶段使用 (流水线中随 Item 在阶段之间传递)
+// 返回的 cv::Mat 与缓存共享像素，调用方不能修改，需要绘制时先 clone
+class PageContext
+{
+public:
+    explicit PageContext(ImagePtr image) : m_path(image->path), m_debug_stem(image->debug_stem()), m_image(std::move(image))
+    {
+    }
+
+    static std::shared_ptr<PageContext> read(const std::string &path)
+    {
+        auto image = Image::read(path);
+        if (!image)
+        {
+            return nullptr;
+        }
+        return std::make_shared<PageContext>(std::move(image));
+    }
+
+    const ImagePtr &image() const
+    {
+        return m_image;
+    }
+
+    const std::string &path() const
+    {
+        return m_path;
+    }
+
+    // 见 Image::debug_stem，释放图像之后仍然可用
+    const std::string &debug_stem() const
+    {
+        return m_debug_stem;
+    }
+
+    const cv::Mat &gray()
+    {
+        if (m_gray.empty())
+        {
+            m_gray = m_image->gray();
+        }
+        return m_gray;
+    }
+
+    const cv::Mat &bgr()
+    {
+        if (m_bgr.empty())
+        {
+            m_bgr = m_image->bgr();
+        }
+        return m_bgr;
+    }
+
+    const cv::Mat &blurred()
+    {
+        if (m_blurred.empty())
+        {
+            cv::GaussianBlur(gray(), m_blurred, cv::Size(5, 5), 0);
+        }
+        return m_blurred;
+    }
+
+    const cv::Mat &edges()
+    {
+        if (m_edges.empty())
+        {
+            cv::Canny(blurred(), m_edges, 150, 200);
+        }
+        return m_edges;
+    }
+
+    // Otsu 二值化并反色，前景 (黑色的字和线) 为 255
+    const cv::Mat &binary()
+    {
+        if (m_binary.empty())
+        {
+            cv::threshold(gray(), m_binary, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+        }
+        return m_binary;
+    }
+
+    // HoughLinesP 在边缘图上检测到的原始线段，未过滤方向
+    const std::vector<cv::Vec4i> &hough_lines()
+    {
+        if (!m_hough_lines)
+        {
+            m_hough_lines.emplace();
+            cv::HoughLinesP(edges(), *m_hough_lines, 1, CV_PI / 180, 100, 10, 2);
+        }
+        return *m_hough_lines;
+    }
+
+    // 按检测器名字缓存的表格线段，第一次请求时调用 detect(*this) 计算
+    template <typename Detect>
+    const Rects &segments(const std::string &detector, Detect &&detect)
+    {
+        auto it = m_segments.find(detector);
+        if (it == m_segments.end())
+        {
+            it = m_segments.emplace(detector, detect(*this)).first;
+        }
+        return it->second;
+    }
+
+    // 释放图像和像素缓存，只保留路径和已经计算出的线段
+    void release_pixels()
+    {
+        m_gray.release();
+        m_bgr.release();
+        m_blurred.release();
+        m_edges.release();
+        m_binary.release();
+        m_image.reset();
+    }
+
+private:
+    std::string m_path;
+    std::string m_debug_stem;
+    ImagePtr m_image;
+    cv::Mat m_gray;
+    cv::Mat m_bgr;
+    cv::Mat m_blurred;
+    cv::Mat m_edges;
+    cv::Mat m_binary;
+    std::optional<std::vector<cv::Vec4i>> m_hough_lines;
+    std::map<std::string, Rects> m_segments;
+};
+
+using PageContextPtr = std::shared_ptr<PageContext>;
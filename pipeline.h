@@ -0,0 +1,284 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "archive.h"
+#include "args.h"
+#include "image.h"
+#include "page_context.h"
+#include "queue.h"
+#include "recognise.h"
+
+// 按需产生图片路径："-" 从 stdin 逐行读取，"@file" 从列表文件逐行读取，其它参数本身就是路径
+class PathSource
+{
+public:
+    explicit PathSource(std::vector<std::string> args) : m_args(std::move(args))
+    {
+    }
+
+    std::optional<std::string> next()
+    {
+        while (true)
+        {
+            if (m_list)
+            {
+                std::string line;
+                if (std::getline(*m_list, line))
+                {
+                    if (!line.empty() && line.back() == '\r')
+                    {
+                        line.pop_back();
+                    }
+                    if (!line.empty())
+                    {
+                        return line;
+                    }
+                    continue;
+                }
+                m_list = nullptr;
+                m_file.close();
+            }
+
+            if (m_index >= m_args.size())
+            {
+                return std::nullopt;
+            }
+
+            const auto &arg = m_args[m_index++];
+            if (arg == "-")
+            {
+                m_list = &std::cin;
+            }
+            else if (arg.starts_with('@'))
+            {
+                m_file.open(arg.substr(1));
+                if (!m_file)
+                {
+                    std::println(stderr, "Could not open list file {}.", arg.substr(1));
+                    continue;
+                }
+                m_list = &m_file;
+            }
+            else
+            {
+                return arg;
+            }
+        }
+    }
+
+private:
+    std::vector<std::string> m_args;
+    size_t m_index{};
+    std::istream *m_list{};
+    std::ifstream m_file;
+};
+
+// 流式批处理：解码、预处理、OCR、线段检测、输出各自运行在独立的线程上，
+// 阶段之间用有界队列连接，解码 I/O 与识别重叠，内存占用与任务总数无关
+class Pipeline
+{
+public:
+    static constexpr size_t queue_capacity = 4;
+
+    struct Item
+    {
+        size_t seq{};
+        std::string path;
+        int page_number{}; // 多页文件中的页码，从 0 开始
+        PageContextPtr context;
+        fixed2_debugger::Page page;
+        Rects segments;
+    };
+
+    // 返回输出的页数；OCR 引擎不可用或归档写入失败时停止所有阶段，放弃本次写入的归档并返回 std::nullopt
+    static std::optional<size_t> run(const Args &args)
+    {
+        std::unique_ptr<archive::Writer> writer;
+        if (!args.archive.empty())
+        {
+            writer = std::make_unique<archive::Writer>(args.archive);
+            if (!*writer)
+            {
+                return std::nullopt;
+            }
+        }
+
+        BoundedQueue<Item> decoded(queue_capacity);
+        BoundedQueue<Item> preprocessed(queue_capacity);
+        BoundedQueue<Item> recognised(queue_capacity);
+        BoundedQueue<Item> detected(queue_capacity);
+
+        // 关闭所有队列，各阶段取完队列中剩余的元素后退出，解码阶段不再读入新的图片
+        std::atomic_bool failed{false};
+        const auto fail = [&]
+        {
+            failed = true;
+            decoded.close();
+            preprocessed.close();
+            recognised.close();
+            detected.close();
+        };
+
+        const auto num_ocr_workers = static_cast<size_t>(std::max(args.threads, 1));
+        std::atomic_size_t ocr_workers_left{num_ocr_workers};
+        size_t count = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::jthread> stages;
+
+            stages.emplace_back([&]
+                                {
+                PathSource source(args.images.empty() ? std::vector<std::string>{"-"} : args.images);
+                size_t seq = 0;
+                bool closed = false;
+                while (!closed)
+                {
+                    const auto path = source.next();
+                    if (!path)
+                    {
+                        break;
+                    }
+
+                    // 多页文件逐页解码，每一页是一个 Item；
+                    // 解码失败的图片也要占一个序号，输出阶段才能按顺序继续
+                    PageReader reader(*path);
+                    auto image = reader.next();
+                    do
+                    {
+                        Item item{seq++, *path};
+                        if (image)
+                        {
+                            item.page_number = image->page;
+                            item.context = std::make_shared<PageContext>(std::move(image));
+                        }
+                        if (!decoded.push(std::move(item)))
+                        {
+                            closed = true;
+                            break;
+                        }
+                    } while ((image = reader.next()));
+                }
+                decoded.close(); });
+
+            stages.emplace_back([&]
+                                {
+                while (auto item = decoded.pop())
+                {
+                    // 预先计算线段检测需要的中间结果，与 OCR 重叠
+                    if (item->context)
+                    {
+                        if (args.line_detector == "hough")
+                        {
+                            item->context->edges();
+                        }
+                        else
+                        {
+                            item->context->binary();
+                        }
+                    }
+                    preprocessed.push(std::move(*item));
+                }
+                preprocessed.close(); });
+
+            for (size_t w = 0; w < num_ocr_workers; ++w)
+            {
+                stages.emplace_back([&]
+                                    {
+                    auto engine = EnginePool::instance().acquire(args);
+                    if (!engine)
+                    {
+                        std::println(stderr, "Could not acquire an OCR engine for a pipeline worker.");
+                        fail();
+                    }
+                    while (auto item = failed ? std::nullopt : preprocessed.pop())
+                    {
+                        if (item->context)
+                        {
+                            item->page = Recognise::texts_recognise(*item->context, args, *engine);
+                        }
+                        recognised.push(std::move(*item));
+                    }
+                    if (--ocr_workers_left == 0)
+                    {
+                        recognised.close();
+                    } });
+            }
+
+            stages.emplace_back([&]
+                                {
+                while (auto item = recognised.pop())
+                {
+                    if (item->context)
+                    {
+                        item->segments = Recognise::segments_recognise(*item->context, args);
+                        // 后续阶段只需要识别结果，尽早释放像素
+                        item->context->release_pixels();
+                    }
+                    detected.push(std::move(*item));
+                }
+                detected.close(); });
+
+            stages.emplace_back([&]
+                                {
+                // 多个 OCR worker 会打乱顺序，这里按序号重新排序后输出
+                std::map<size_t, Item> pending;
+                size_t next_seq = 0;
+                while (auto item = failed ? std::nullopt : detected.pop())
+                {
+                    pending.emplace(item->seq, std::move(*item));
+                    for (auto it = pending.begin(); it != pending.end() && it->first == next_seq; it = pending.erase(it), ++next_seq)
+                    {
+                        if (!output(it->second, writer.get()))
+                        {
+                            std::println(stderr, "Could not write archive {}.", args.archive);
+                            fail();
+                            break;
+                        }
+                    }
+                }
+                count = next_seq; });
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (failed)
+        {
+            if (writer)
+            {
+                writer->discard();
+            }
+            return std::nullopt;
+        }
+
+        std::println(stderr, "pages: {}, ocr workers: {}, elapsed: {:.3f}s, {:.2f} pages/s",
+                     count, num_ocr_workers, elapsed, elapsed > 0 ? count / elapsed : 0.0);
+        return count;
+    }
+
+private:
+    // 归档写入失败时返回 false
+    static bool output(const Item &item, archive::Writer *writer)
+    {
+        if (writer)
+        {
+            writer->append(item.page, static_cast<uint32_t>(item.page_number));
+            if (!*writer)
+            {
+                return false;
+            }
+        }
+
+        std::println("{}\tpage: {}\tlines: {}\twords: {}\tsegments: {}", item.path, item.page_number + 1, item.page.lines().size(), item.page.words().size(), item.segments.size());
+        return true;
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// 有界阻塞队列：队列满时 push 阻塞，close 之后 pop 取完剩余元素再返回 std::nullopt
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(std::max<size_t>(capacity, 1))
+    {
+    }
+
+    // 队列已关闭时返回 false，元素被丢弃
+    bool push(T value)
+    {
+        std::unique_lock lock(m_mutex);
+        m_not_full.wait(lock, [&]
+                        { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed)
+        {
+            return false;
+        }
+        m_items.push_back(std::move(value));
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop()
+    {
+        std::unique_lock lock(m_mutex);
+        m_not_empty.wait(lock, [&]
+                         { return m_closed || !m_items.empty(); });
+        if (m_items.empty())
+        {
+            return std::nullopt;
+        }
+        auto value = std::move(m_items.front());
+        m_items.pop_front();
+        m_not_full.notify_one();
+        return value;
+    }
+
+    void close()
+    {
+        std::lock_guard lock(m_mutex);
+        m_closed = true;
+        m_not_empty.notify_all();
+        m_not_full.notify_all();
+    }
+
+private:
+    size_t m_capacity;
+    bool m_closed{};
+    std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+    std::deque<T> m_items;
+};
@@ -2,15 +2,24 @@
 
 #include <print>
 #include <algorithm>
+#include <atomic>
+#include <optional>
+#include <chrono>
+#include <thread>
 #include <tuple>
 #include <vector>
 #include <unordered_set>
 
 #include "algo.h"
 #include "args.h"
+#include "debug_writer.h"
 #include "debugger.h"
+#include "engine_pool.h"
 #include "fixed_debugger.h"
 #include "fixed2_debugger.h"
+#include "normalize.h"
+#include "page_context.h"
+#include "table.h"
 
 #include <tesseract/baseapi.h>
 
@@ -22,56 +31,34 @@ public:
         for (const auto &image_path : args.images)
         {
             std::println("{} ----------------------------------------------------------------------------", image_path);
-            Debugger debugger(args);
-            fixed_debugger::Debugger fixed_debugger(args);
-            fixed2_debugger::Debugger fixed2_debugger(args);
-            debugger.set_image(image_path);
-            fixed_debugger.set_image(image_path);
-            fixed2_debugger.set_image(image_path);
-            auto api = std::make_shared<tesseract::TessBaseAPI>();
-            if (api->Init(args.tessdata.c_str(), args.lang.c_str()))
-            {
-                std::println(stderr, "Could not initialize tesseract.");
-                return;
-            }
-            auto image = std::shared_ptr<Pix>(pixRead(image_path.c_str()), [](Pix *p)
-                                              { pixDestroy(&p); });
-
-            // 获取图像的宽度和高度
-            l_int32 width, height, depth;
-            if (pixGetDimensions(image.get(), &width, &height, &depth))
+            // 只解码一次，识别和所有调试渲染器共享
+            const auto decoded = Image::read(image_path);
+            if (!decoded)
             {
-                std::println(stderr, "Could not get image dimensions.");
                 return;
             }
-            std::println("width: {}, height: {}, depth: {}", width, height, depth);
+            const auto &image = decoded->pix;
 
-            // 获取图像分辨率
-            l_int32 xres, yres;
-            if (pixGetResolution(image.get(), &xres, &yres))
-            {
-                std::println(stderr, "Could not get image resolution.");
-                return;
-            }
-            std::println("xres: {}, yres: {}", xres, yres);
-
-            api->SetImage(image.get());
-
-            // 设置图像分辨率
-            l_int32 xres_new = 300, yres_new = 300;
-            if (pixSetResolution(image.get(), xres_new, yres_new))
+            Debugger debugger(args);
+            fixed_debugger::Debugger fixed_debugger(args);
+            fixed2_debugger::Debugger fixed2_debugger(args);
+            debugger.set_image(decoded);
+            fixed_debugger.set_image(decoded);
+            fixed2_debugger.set_image(decoded);
+            auto api = EnginePool::instance().acquire(args);
+            if (!api)
             {
-                std::println(stderr, "Could not set image resolution.");
                 return;
             }
-            std::println("xres: {} -> {}, yres: {} -> {}", xres, xres_new, yres, yres_new);
 
-            if (pixGetDimensions(image.get(), &width, &height, &depth))
+            // 在归一化的图像上识别，调试渲染仍使用原图，识别结果映射回原图坐标
+            PageContext context(decoded);
+            const auto [normalized, transform] = Normalize::run(context, args);
+            if (!normalized)
             {
-                std::println(stderr, "Could not get image dimensions.");
                 return;
             }
-            std::println("width: {}, height: {}, depth: {}", width, height, depth);
+            api->SetImage(normalized->pix.get());
 
             if (api->Recognize(nullptr))
             {
@@ -79,54 +66,32 @@ public:
                 return;
             }
 
-            auto res_it = std::shared_ptr<tesseract::ResultIterator>(api->GetIterator());
-
-            while (!res_it->Empty(tesseract::RIL_TEXTLINE))
-            {
-                if (res_it->Empty(tesseract::RIL_WORD))
-                {
-                    res_it->Next(tesseract::RIL_WORD);
-                    continue;
-                }
-
-                Rect line_bbox, word_bbox;
-                int line_conf, word_conf;
-                res_it->BoundingBox(tesseract::RIL_TEXTLINE, &line_bbox.x0, &line_bbox.y0, &line_bbox.x1, &line_bbox.y1);
-                res_it->BoundingBox(tesseract::RIL_WORD, &word_bbox.x0, &word_bbox.y0, &word_bbox.x1, &word_bbox.y1);
-                line_conf = res_it->Confidence(tesseract::RIL_TEXTLINE);
-                word_conf = res_it->Confidence(tesseract::RIL_WORD);
-
-                debugger.on_line(line_bbox);
-                debugger.on_word(word_bbox);
-                // std::println("line {} conf: {}", line_bbox.to_string(), line_conf);
-                // std::println("word {} conf: {}", word_bbox.to_string(), word_conf);
-
-                do
+            walk_symbols(
+                *api,
+                [&](const Rect &line_bbox)
+                { debugger.on_line(transform.to_original(line_bbox)); },
+                [&](const Rect &word_bbox)
+                { debugger.on_word(transform.to_original(word_bbox)); },
+                [&](const Symbol &symbol)
                 {
-                    Rect char_bbox;
-                    res_it->BoundingBox(tesseract::RIL_SYMBOL, &char_bbox.x0, &char_bbox.y0, &char_bbox.x1, &char_bbox.y1);
-                    auto conf = res_it->Confidence(tesseract::RIL_SYMBOL);
-                    auto text = std::shared_ptr<char>(res_it->GetUTF8Text(tesseract::RIL_SYMBOL));
-                    bool bold, italic, underline, monospace, serif, smallcaps;
-                    int size, font_id;
-
-                    auto font_name = res_it->WordFontAttributes(&bold, &italic, &underline, &monospace, &serif, &smallcaps, &size, &font_id);
-
                     // char_bbox.right = std::min(char_bbox.right, char_bbox.left + (int)(size * 1.5));
-                    if (conf > args.confidence)
+                    if (symbol.it.Confidence(tesseract::RIL_SYMBOL) > args.confidence)
                     {
-                        // std::println("{} char {} conf: {} size: {}", text.get(), char_bbox.to_string(), conf, size);
-
-                        debugger.on_char(char_bbox, std::string(text.get()), size);
-                        fixed_debugger.on_char(line_bbox, word_bbox, char_bbox, std::string(text.get()), size);
-                        fixed2_debugger.on_char(line_bbox, word_bbox, char_bbox, std::string(text.get()), size);
+                        // std::println("{} char {} conf: {} size: {}", symbol.text, symbol.bbox.to_string(), conf, symbol.pointsize);
+
+                        const auto line_bbox = transform.to_original(symbol.line_bbox);
+                        const auto word_bbox = transform.to_original(symbol.word_bbox);
+                        const auto bbox = transform.to_original(symbol.bbox);
+                        debugger.on_char(bbox, symbol.text, symbol.pointsize);
+                        fixed_debugger.on_char(line_bbox, word_bbox, bbox, symbol.text, symbol.pointsize);
+                        fixed2_debugger.on_char(line_bbox, word_bbox, bbox, symbol.text, symbol.pointsize);
                     }
+                });
 
-                    res_it->Next(tesseract::RIL_SYMBOL);
-                } while (!res_it->Empty(tesseract::RIL_BLOCK) && !res_it->IsAtBeginningOf(tesseract::RIL_WORD));
+            if (args.debug(DebugResult))
+            {
+                DebugWriter::instance().write(std::format("{}.ori.png", decoded->debug_stem()), image);
             }
-
-            pixWrite(std::format("{}.ori.png", std::filesystem::path(image_path).filename().string()).c_str(), image.get(), IFF_PNG);
         }
     }
 
@@ -199,144 +164,513 @@ public:
     {
         for (const auto &image_path : args.images)
         {
-            auto mat = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
-            auto blurred = cv::Mat(mat.size(), CV_8UC1);
-            blurred = cv::Scalar(255);
-            auto edges = cv::Mat(mat.size(), CV_8UC1);
-            edges = cv::Scalar(255);
-            auto lines = cv::Mat(mat.size(), CV_8UC1);
-            lines = cv::Scalar(255);
-            std::vector<cv::Vec4i> lines_vector;
-
-            cv::GaussianBlur(mat, blurred, cv::Size(5, 5), 0);
-            cv::Canny(blurred, edges, 150, 200);
-            cv::HoughLinesP(edges, lines_vector, 1, CV_PI / 180, 100, 10, 2);
-            lines = cv::Scalar(255, 255, 255);
-
-            for (int i = 0; i < lines_vector.size(); i++)
+            const auto context = PageContext::read(image_path);
+            if (!context)
             {
-                cv::Vec4i l = lines_vector[i];
-                const auto x0 = l[0], y0 = l[1], x1 = l[2], y1 = l[3];
-                if (x0 != x1 && y0 != y1)
-                {
-                    continue;
-                }
-                cv::line(lines, cv::Point(x0, y0), cv::Point(x1, y1), cv::Scalar(0, 0, 0), 1, cv::LINE_AA);
+                continue;
+            }
+            const auto segments = hough_segments(*context);
+
+            if (!args.debug(DebugIntermediate))
+            {
+                continue;
             }
 
-            cv::imwrite(std::format("{}.blur.png", std::filesystem::path(image_path).stem().string()), blurred);
-            cv::imwrite(std::format("{}.edges.png", std::filesystem::path(image_path).stem().string()), edges);
-            cv::imwrite(std::format("{}.lines.png", std::filesystem::path(image_path).stem().string()), lines);
+            auto lines = cv::Mat(context->gray().size(), CV_8UC1, cv::Scalar(255));
+            for (const auto &seg : segments)
+            {
+                cv::line(lines, cv::Point(seg.x0, seg.y0), cv::Point(seg.x1, seg.y1), cv::Scalar(0, 0, 0), 1, cv::LINE_AA);
+            }
+
+            auto &writer = DebugWriter::instance();
+            writer.write(std::format("{}.blur.png", context->debug_stem()), context->blurred());
+            writer.write(std::format("{}.edges.png", context->debug_stem()), context->edges());
+            writer.write(std::format("{}.lines.png", context->debug_stem()), std::move(lines));
         }
     }
 
     static fixed2_debugger::Page texts_recognise(const std::string &image_path, const Args &args)
     {
-        auto api = std::make_shared<tesseract::TessBaseAPI>();
-        if (api->Init(args.tessdata.c_str(), args.lang.c_str()))
+        const auto decoded = Image::read(image_path);
+        if (!decoded)
         {
-            std::println(stderr, "Could not initialize tesseract.");
             return {};
         }
-        auto image = std::shared_ptr<Pix>(pixRead(image_path.c_str()), [](Pix *p)
-                                          { pixDestroy(&p); });
+        return texts_recognise(decoded, args);
+    }
 
-        // 获取图像的宽度和高度
-        l_int32 width, height, depth;
-        if (pixGetDimensions(image.get(), &width, &height, &depth))
+    static fixed2_debugger::Page texts_recognise(const ImagePtr &decoded, const Args &args, tesseract::TessBaseAPI &api)
+    {
+        PageContext context(decoded);
+        return texts_recognise(context, args, api);
+    }
+
+    // 使用调用方持有的引擎识别，引擎在多张图片之间复用；--cascade 时该引擎用于第二级
+    // 识别在归一化后的图像上进行，返回的 Page 使用原图坐标；灰度图取自 context，线段检测可以复用
+    static fixed2_debugger::Page texts_recognise(PageContext &context, const Args &args, tesseract::TessBaseAPI &api)
+    {
+        const auto [normalized, transform] = Normalize::run(context, args);
+        if (!normalized)
         {
-            std::println(stderr, "Could not get image dimensions.");
             return {};
         }
-        std::println("width: {}, height: {}, depth: {}", width, height, depth);
+        auto page = args.cascade ? texts_recognise_cascade(normalized, args, api) : recognise_page(normalized, api);
+        if (!transform.identity())
+        {
+            page.map_boxes([&](const Rect &bbox)
+                           { return transform.to_original(bbox); });
+        }
+        return page;
+    }
+
+    // 用给定的引擎识别整页
+    static fixed2_debugger::Page recognise_page(const ImagePtr &decoded, tesseract::TessBaseAPI &api)
+    {
+        // 清除上一张图片的识别结果
+        api.Clear();
+
+        const auto &image = decoded->pix;
 
-        // 获取图像分辨率
-        l_int32 xres, yres;
-        if (pixGetResolution(image.get(), &xres, &yres))
+        // 分辨率由调用方在 SetImage 之前设置好 (见 Normalize)，Tesseract 在 SetImage 时读取
+        api.SetImage(image.get());
+
+        if (api.Recognize(nullptr))
         {
-            std::println(stderr, "Could not get image resolution.");
+            std::println(stderr, "Recognize failed");
             return {};
         }
-        std::println("xres: {}, yres: {}", xres, yres);
 
-        api->SetImage(image.get());
+        return extract_page(api);
+    }
 
-        // 设置图像分辨率
-        l_int32 xres_new = 300, yres_new = 300;
-        if (pixSetResolution(image.get(), xres_new, yres_new))
+    // walk_symbols 传给 on_symbol 的当前符号，以及它所在的行和词
+    struct Symbol
+    {
+        const tesseract::ResultIterator &it;
+        Rect line_bbox;
+        Rect word_bbox;
+        int pointsize; // 词的字号
+        Rect bbox;
+        const char *text;
+    };
+
+    // 按符号顺序遍历一次识别结果，行、词级别的属性只在行首、词首各查询一次，
+    // 字体属性是词级别的，也只在词首查询。空的符号被跳过，没有符号的行和词不会回调
+    template <typename OnLine, typename OnWord, typename OnSymbol>
+    static void walk_symbols(tesseract::TessBaseAPI &api, OnLine &&on_line, OnWord &&on_word, OnSymbol &&on_symbol)
+    {
+        const std::unique_ptr<tesseract::ResultIterator> it(api.GetIterator());
+        if (!it)
         {
-            std::println(stderr, "Could not set image resolution.");
-            return {};
+            return;
         }
-        std::println("xres: {} -> {}, yres: {} -> {}", xres, xres_new, yres, yres_new);
 
-        if (pixGetDimensions(image.get(), &width, &height, &depth))
+        Rect line_bbox, word_bbox;
+        int pointsize = 0;
+        bool line_pending = false, word_pending = false;
+        do
+        {
+            line_pending |= it->IsAtBeginningOf(tesseract::RIL_TEXTLINE);
+            word_pending |= it->IsAtBeginningOf(tesseract::RIL_WORD);
+            if (it->Empty(tesseract::RIL_SYMBOL))
+            {
+                continue;
+            }
+
+            if (line_pending)
+            {
+                it->BoundingBox(tesseract::RIL_TEXTLINE, &line_bbox.x0, &line_bbox.y0, &line_bbox.x1, &line_bbox.y1);
+                on_line(line_bbox);
+                line_pending = false;
+            }
+            if (word_pending)
+            {
+                it->BoundingBox(tesseract::RIL_WORD, &word_bbox.x0, &word_bbox.y0, &word_bbox.x1, &word_bbox.y1);
+                bool bold, italic, underline, monospace, serif, smallcaps;
+                int font_id;
+                pointsize = 0;
+                it->WordFontAttributes(&bold, &italic, &underline, &monospace, &serif, &smallcaps, &pointsize, &font_id);
+                on_word(word_bbox);
+                word_pending = false;
+            }
+
+            Rect bbox;
+            it->BoundingBox(tesseract::RIL_SYMBOL, &bbox.x0, &bbox.y0, &bbox.x1, &bbox.y1);
+            const std::unique_ptr<char[]> text(it->GetUTF8Text(tesseract::RIL_SYMBOL));
+            on_symbol(Symbol{*it, line_bbox, word_bbox, pointsize, bbox, text ? text.get() : ""});
+        } while (it->Next(tesseract::RIL_SYMBOL));
+    }
+
+    // 从识别结果中提取 Page，坐标为整张图像的坐标 (即使设置了 SetRectangle)
+    static fixed2_debugger::Page extract_page(tesseract::TessBaseAPI &api)
+    {
+        fixed2_debugger::Page page;
+        extract_page(api, page);
+        return page;
+    }
+
+    // 直接写入调用方的页面缓冲区，页面先被清空，arena 的内存得以复用
+    static void extract_page(tesseract::TessBaseAPI &api, fixed2_debugger::Page &page)
+    {
+        page.clear();
+        Rect line_bbox;
+        walk_symbols(
+            api,
+            [&](const Rect &bbox)
+            {
+                line_bbox = bbox;
+                page.push_line(bbox);
+            },
+            [&](const Rect &bbox)
+            { page.push_word(fixed2_debugger::Page::limit_to_line_height(line_bbox, bbox)); },
+            [&](const Symbol &symbol)
+            { page.push_char(fixed2_debugger::Page::limit_to_line_height(line_bbox, symbol.bbox), symbol.text, symbol.pointsize); });
+    }
+
+    static fixed2_debugger::Page texts_recognise(const ImagePtr &image, const Args &args)
+    {
+        PageContext context(image);
+        return texts_recognise(context, args);
+    }
+
+    static fixed2_debugger::Page texts_recognise(PageContext &context, const Args &args)
+    {
+        if (args.bands > 1)
+        {
+            return texts_recognise_tiled(context, args);
+        }
+        auto api = EnginePool::instance().acquire(args);
+        if (!api)
         {
-            std::println(stderr, "Could not get image dimensions.");
             return {};
         }
-        std::println("width: {}, height: {}, depth: {}", width, height, depth);
+        return texts_recognise(context, args, *api);
+    }
 
-        if (api->Recognize(nullptr))
+    // 两级识别：先用快速引擎 (--fast-lang/--fast-tessdata) 识别整页，
+    // 只有行置信度低于 --confidence 的行再用 accurate 引擎按单行模式重新识别，结果替换原来的行
+    static fixed2_debugger::Page texts_recognise_cascade(const ImagePtr &image, const Args &args, tesseract::TessBaseAPI &accurate)
+    {
+        auto fast = EnginePool::instance().acquire(EngineKey::fast_from(args));
+        if (!fast)
         {
-            std::println(stderr, "Recognize failed");
-            return {};
+            return recognise_page(image, accurate);
+        }
+        auto draft = recognise_page(image, *fast);
+
+        // 按包围盒记录每一行的置信度，提取 Page 时行的包围盒原样保留
+        FlatHashMap<Rect, float> confidences;
+        if (const std::unique_ptr<tesseract::ResultIterator> it(fast->GetIterator()); it)
+        {
+            do
+            {
+                if (it->Empty(tesseract::RIL_TEXTLINE))
+                {
+                    continue;
+                }
+                Rect bbox;
+                it->BoundingBox(tesseract::RIL_TEXTLINE, &bbox.x0, &bbox.y0, &bbox.x1, &bbox.y1);
+                confidences[bbox] = it->Confidence(tesseract::RIL_TEXTLINE);
+            } while (it->Next(tesseract::RIL_TEXTLINE));
         }
 
-        auto res_it = std::shared_ptr<tesseract::ResultIterator>(api->GetIterator());
+        const auto low_confidence = [&](const fixed2_debugger::Line &line)
+        {
+            const auto it = confidences.find(line.bbox);
+            return it == confidences.end() || it->second < args.confidence;
+        };
+        if (std::ranges::none_of(draft.lines(), low_confidence))
+        {
+            return draft;
+        }
 
-        fixed2_debugger::Page page;
+        accurate.Clear();
+        accurate.SetImage(image->pix.get());
+        const auto psm = accurate.GetPageSegMode();
+        accurate.SetPageSegMode(tesseract::PSM_SINGLE_LINE);
 
-        while (!res_it->Empty(tesseract::RIL_TEXTLINE))
+        size_t redone = 0;
+        fixed2_debugger::Page page, line_page;
+        const Rect bounds{0, 0, image->width, image->height};
+        for (const auto &line : draft.lines())
         {
-            if (res_it->Empty(tesseract::RIL_WORD))
+            if (low_confidence(line))
             {
-                res_it->Next(tesseract::RIL_WORD);
-                continue;
+                // 四周留一点空白，单行模式在紧贴文字的矩形上效果较差
+                const auto rect = line.bbox.expand(std::max(line.bbox.height() / 4, 2)) & bounds;
+                if (!rect.is_empty())
+                {
+                    accurate.SetRectangle(rect.x0, rect.y0, rect.width(), rect.height());
+                    if (accurate.Recognize(nullptr) == 0)
+                    {
+                        extract_page(accurate, line_page);
+                        if (!line_page.empty())
+                        {
+                            page.append(line_page);
+                            ++redone;
+                            continue;
+                        }
+                    }
+                }
             }
+            page.append_line(draft, line);
+        }
 
-            Rect line_bbox, word_bbox;
-            int line_conf, word_conf;
-            res_it->BoundingBox(tesseract::RIL_TEXTLINE, &line_bbox.x0, &line_bbox.y0, &line_bbox.x1, &line_bbox.y1);
-            res_it->BoundingBox(tesseract::RIL_WORD, &word_bbox.x0, &word_bbox.y0, &word_bbox.x1, &word_bbox.y1);
-            line_conf = res_it->Confidence(tesseract::RIL_TEXTLINE);
-            word_conf = res_it->Confidence(tesseract::RIL_WORD);
+        // 引擎归还给池时按原来的参数复用
+        accurate.SetPageSegMode(psm);
+        if (args.debug(DebugIntermediate))
+        {
+            std::println(stderr, "cascade: {} of {} lines re-recognised", redone, draft.lines().size());
+        }
+        return page;
+    }
 
-            do
+    // 沿空白行把页面切成横向条带，返回每个条带的行区间 [y0, y1)
+    static std::vector<std::pair<int, int>> split_bands(const cv::Mat &gray, int count)
+    {
+        const auto height = gray.rows;
+        if (count <= 1 || height == 0)
+        {
+            return {{0, height}};
+        }
+
+        // 没有深色像素的行视为空白行
+        std::vector<bool> blank(height);
+        for (int y = 0; y < height; ++y)
+        {
+            const auto row = gray.ptr<uint8_t>(y);
+            blank[y] = std::all_of(row, row + gray.cols, [](uint8_t v)
+                                   { return v >= 128; });
+        }
+
+        // 在每个理想切分位置附近寻找最近的空白行，找不到就不在这里切分
+        const auto radius = height / (2 * count);
+        std::vector<std::pair<int, int>> bands;
+        int y0 = 0;
+        for (int k = 1; k < count; ++k)
+        {
+            const auto target = height * k / count;
+            for (int d = 0; d <= radius; ++d)
             {
-                Rect char_bbox;
-                res_it->BoundingBox(tesseract::RIL_SYMBOL, &char_bbox.x0, &char_bbox.y0, &char_bbox.x1, &char_bbox.y1);
-                auto conf = res_it->Confidence(tesseract::RIL_SYMBOL);
-                auto text = std::shared_ptr<char>(res_it->GetUTF8Text(tesseract::RIL_SYMBOL));
-                bool bold, italic, underline, monospace, serif, smallcaps;
-                int size, font_id;
+                int cut = -1;
+                if (target - d > y0 && blank[target - d])
+                {
+                    cut = target - d;
+                }
+                else if (target + d < height && blank[target + d])
+                {
+                    cut = target + d;
+                }
+                if (cut > y0)
+                {
+                    bands.emplace_back(y0, cut);
+                    y0 = cut;
+                    break;
+                }
+            }
+        }
+        bands.emplace_back(y0, height);
+        return bands;
+    }
 
-                auto font_name = res_it->WordFontAttributes(&bold, &italic, &underline, &monospace, &serif, &smallcaps, &size, &font_id);
+    // 大页面分块并行识别：每个条带一个引擎，通过 SetRectangle 只识别本条带，最后按条带顺序合并
+    static fixed2_debugger::Page texts_recognise_tiled(PageContext &context, const Args &args)
+    {
+        const auto [image, transform] = Normalize::run(context, args);
+        if (!image)
+        {
+            return {};
+        }
+        const auto bands = split_bands(image->gray(), args.bands);
 
-                page.append_char(line_bbox, word_bbox, char_bbox, std::string(text.get()), size);
+        std::vector<Engine> engines;
+        engines.reserve(bands.size());
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            auto engine = EnginePool::instance().acquire(args);
+            if (!engine)
+            {
+                return {};
+            }
+            engines.emplace_back(std::move(engine));
+        }
 
-                res_it->Next(tesseract::RIL_SYMBOL);
-            } while (!res_it->Empty(tesseract::RIL_BLOCK) && !res_it->IsAtBeginningOf(tesseract::RIL_WORD));
+        // SetImage 会 pixClone 共享的 Pix，Leptonica 的引用计数不是线程安全的，
+        // 所以 SetImage 以及归还引擎时的 Clear 都在当前线程串行执行，只有识别和提取并行
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            const auto &[y0, y1] = bands[i];
+            engines[i]->SetImage(image->pix.get());
+            engines[i]->SetRectangle(0, y0, image->width, y1 - y0);
         }
 
+        std::vector<fixed2_debugger::Page> pages(bands.size());
+        std::atomic_bool failed{false};
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(bands.size());
+            for (size_t i = 0; i < bands.size(); ++i)
+            {
+                workers.emplace_back([&, i]
+                                     {
+                    if (engines[i]->Recognize(nullptr))
+                    {
+                        std::println(stderr, "Recognize failed on band {} ({}..{})", i, bands[i].first, bands[i].second);
+                        failed = true;
+                        return;
+                    }
+                    pages[i] = extract_page(*engines[i]); });
+            }
+        }
+
+        // 缺少一个条带的页面不能当作完整结果，改为整页识别一次
+        fixed2_debugger::Page page;
+        if (failed)
+        {
+            std::println(stderr, "Falling back to whole-page recognition.");
+            page = recognise_page(image, *engines.front());
+        }
+        else
+        {
+            for (const auto &band_page : pages)
+            {
+                page.append(band_page);
+            }
+        }
+        if (!transform.identity())
+        {
+            page.map_boxes([&](const Rect &bbox)
+                           { return transform.to_original(bbox); });
+        }
         return page;
     }
 
+    // 返回每张图片的各页识别结果，多页 TIFF 在同一个 worker 上逐页解码和识别
+    // 有 worker 拿不到引擎时返回 std::nullopt，此时的结果不完整，不应当使用
+    static std::optional<std::vector<std::vector<fixed2_debugger::Page>>> batch_recognise(const Args &args)
+    {
+        const auto &images = args.images;
+        std::vector<std::vector<fixed2_debugger::Page>> pages(images.size());
+        std::atomic_size_t next_index{0};
+        std::atomic_size_t page_count{0};
+        std::atomic_bool failed{false};
+
+        const auto num_workers = std::clamp<size_t>(args.threads, 1, std::max<size_t>(images.size(), 1));
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(num_workers);
+            for (size_t w = 0; w < num_workers; ++w)
+            {
+                workers.emplace_back([&]
+                                     {
+                    // 每个 worker 独占一个引擎和一个字形缓存 (FreeType 实例)
+                    auto engine = EnginePool::instance().acquire(args);
+                    if (!engine)
+                    {
+                        std::println(stderr, "Could not acquire an OCR engine for a batch worker.");
+                        failed = true;
+                        return;
+                    }
+                    std::shared_ptr<GlyphCache> glyphs;
+                    if (args.debug(DebugResult))
+                    {
+                        glyphs = std::make_shared<GlyphCache>(args.font);
+                    }
+
+                    for (auto i = next_index++; i < images.size(); i = next_index++)
+                    {
+                        PageReader reader(images[i]);
+                        while (const auto image = reader.next())
+                        {
+                            // 识别中的页面 arena 按固定大小起步，保存到批处理结束的结果拷贝一份，只占实际内容的大小
+                            const auto recognised = texts_recognise(image, args, *engine);
+                            const auto &page = pages[i].emplace_back(recognised);
+                            ++page_count;
+                            if (!glyphs)
+                            {
+                                continue;
+                            }
+
+                            fixed2_debugger::Debugger debugger(args, glyphs);
+                            debugger.set_image(image);
+                            debugger.set_page(page);
+                        }
+                    } });
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::println("images: {}, pages: {}, workers: {}, elapsed: {:.3f}s, {:.2f} pages/s",
+                     images.size(), page_count.load(), num_workers, elapsed, elapsed > 0 ? page_count.load() / elapsed : 0.0);
+
+        if (failed)
+        {
+            return std::nullopt;
+        }
+        return pages;
+    }
+
     static Rects segments_recognise(const std::string &image_path, const Args &args)
     {
-        auto mat = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
-        auto blurred = cv::Mat(mat.size(), CV_8UC1);
-        blurred = cv::Scalar(255);
-        auto edges = cv::Mat(mat.size(), CV_8UC1);
-        edges = cv::Scalar(255);
-        auto lines = cv::Mat(mat.size(), CV_8UC1);
-        lines = cv::Scalar(255);
-        std::vector<cv::Vec4i> lines_vector;
-
-        cv::GaussianBlur(mat, blurred, cv::Size(5, 5), 0);
-        cv::Canny(blurred, edges, 150, 200);
-        cv::HoughLinesP(edges, lines_vector, 1, CV_PI / 180, 100, 10, 2);
-        lines = cv::Scalar(255, 255, 255);
+        const auto context = PageContext::read(image_path);
+        if (!context)
+        {
+            return {};
+        }
+        return segments_recognise(*context, args);
+    }
+
+    static Rects segments_recognise(const ImagePtr &image, const Args &args)
+    {
+        PageContext context(image);
+        return segments_recognise(context, args);
+    }
+
+    // 按 --line-detector 检测表格线段，结果缓存在 context 中
+    static const Rects &segments_recognise(PageContext &context, const Args &args)
+    {
+        return context.segments(args.line_detector, [&](PageContext &)
+                                {
+            const auto debug = args.debug(DebugIntermediate);
+            const auto &stem = context.debug_stem();
+            auto &writer = DebugWriter::instance();
+
+            Rects segments;
+            if (args.line_detector == "hough")
+            {
+                segments = hough_segments(context);
+                if (debug)
+                {
+                    writer.write(std::format("{}.blur.png", stem), context.blurred());
+                    writer.write(std::format("{}.edges.png", stem), context.edges());
+                }
+            }
+            else
+            {
+                segments = rle_segments(context);
+                if (debug)
+                {
+                    writer.write(std::format("{}.binary.png", stem), context.binary());
+                }
+            }
+
+            if (debug)
+            {
+                auto lines = cv::Mat(context.gray().size(), CV_8UC1, cv::Scalar(255));
+                for (const auto &seg : segments)
+                {
+                    cv::line(lines, cv::Point(seg.x0, seg.y0), cv::Point(seg.x1, seg.y1), cv::Scalar(0, 0, 0), 1, cv::LINE_AA);
+                }
+                writer.write(std::format("{}.lines.png", stem), std::move(lines));
+            }
+            return segments; });
+    }
+
+    // Gaussian + Canny + HoughLinesP (均由 context 缓存)，只保留严格水平或竖直的线段
+    static Rects hough_segments(PageContext &context)
+    {
+        const auto &lines_vector = context.hough_lines();
 
         Rects segments;
         segments.reserve(lines_vector.size());
@@ -352,30 +686,60 @@ public:
             const auto maxx = std::max(x0, x1);
             const auto miny = std::min(y0, y1);
             const auto maxy = std::max(y0, y1);
-            cv::line(lines, cv::Point(minx, miny), cv::Point(maxx, maxy), cv::Scalar(0, 0, 0), 1, cv::LINE_AA);
             segments.push_back({minx, miny, maxx, maxy});
         }
+        return segments;
+    }
 
-        cv::imwrite(std::format("{}.blur.png", std::filesystem::path(image_path).stem().string()), blurred);
-        cv::imwrite(std::format("{}.edges.png", std::filesystem::path(image_path).stem().string()), edges);
-        cv::imwrite(std::format("{}.lines.png", std::filesystem::path(image_path).stem().string()), lines);
+    // 基于游程的横竖线检测：在 context 的 Otsu 二值图上逐行扫描长的黑色游程得到横线，
+    // 转置后用同样的方法得到竖线。游程中不超过 max_gap 的空隙视为断点，与 HoughLinesP 的 maxLineGap 含义相同
+    static Rects rle_segments(PageContext &context, int min_length = 100, int max_gap = 2)
+    {
+        const auto &binary = context.binary();
+        cv::Mat transposed;
+        cv::transpose(binary, transposed);
 
+        Rects segments;
+        scan_runs(binary, min_length, max_gap, [&](int row, int begin, int end)
+                  { segments.push_back({begin, row, end, row}); });
+        scan_runs(transposed, min_length, max_gap, [&](int col, int begin, int end)
+                  { segments.push_back({col, begin, col, end}); });
         return segments;
     }
 
-    template <typename T>
-    static _Rect<T> BoundingBox(const _Rects<T> &segs)
+    // 逐行扫描非零像素的游程，对长度不小于 min_length 的游程回调 (行号, 起点, 终点)，终点包含在内
+    template <typename F>
+    static void scan_runs(const cv::Mat &binary, int min_length, int max_gap, F &&on_run)
     {
-        auto bbox = segs.front();
-        for (const auto &seg : segs)
+        for (int y = 0; y < binary.rows; ++y)
         {
-            // do not use |, because seg is empty
-            bbox.x0 = std::min(bbox.x0, seg.x0);
-            bbox.y0 = std::min(bbox.y0, seg.y0);
-            bbox.x1 = std::max(bbox.x1, seg.x1);
-            bbox.y1 = std::max(bbox.y1, seg.y1);
+            const auto row = binary.ptr<uint8_t>(y);
+            int begin = -1, last = -1;
+            for (int x = 0; x < binary.cols; ++x)
+            {
+                if (!row[x])
+                {
+                    continue;
+                }
+                if (begin >= 0 && x - last - 1 > max_gap)
+                {
+                    if (last - begin + 1 >= min_length)
+                    {
+                        on_run(y, begin, last);
+                    }
+                    begin = -1;
+                }
+                if (begin < 0)
+                {
+                    begin = x;
+                }
+                last = x;
+            }
+            if (begin >= 0 && last - begin + 1 >= min_length)
+            {
+                on_run(y, begin, last);
+            }
         }
-        return bbox;
     }
 
     // static bool is_noisy(const Rectsf32 &segs, const fixed2_debugger::Page &page)
@@ -390,13 +754,13 @@ public:
 
     //     Rectsf32 bbox = BoundingBox(segs);
 
-    //     for (const auto &line : page.m_lines)
+    //     for (const auto &line : page.lines())
     //     {
     //         if (bbox.contains(line.bbox))
     //         {
     //             return false;
     //         }
-    //         for (const auto &word : line.words)
+    //         for (const auto &word : page.words_of(line))
     //         {
     //             if (bbox.contains(word.bbox))
     //             {
@@ -407,7 +771,7 @@ public:
     //             {
     //                 return true;
     //             }
-    //             for (const auto &c : word.chars)
+    //             for (const auto &c : page.chars_of(word))
     //             {
     //                 // any segment in one char, this noise
     //                 for (const auto &seg : segs)
@@ -423,43 +787,38 @@ public:
     //     return false;
     // }
 
-    static Rects filter_segments(const Rects &segments, const fixed2_debugger::Page &page, const std::string &image_path = "")
+    // 由线段重建表格网格，并把 page 中的词和字分配到单元格；
+    // 传入 context 时把表格和单元格渲染到 tables.png，底图取自 context 缓存的彩色图
+    static std::vector<table::Table> tables_from_segments(const Rects &segments, const fixed2_debugger::Page &page, PageContext *context = nullptr)
     {
-        cv::Mat mat;
-        if (!image_path.empty())
-        {
-            mat = cv::imread(image_path, cv::IMREAD_COLOR);
-        }
-
         auto segs = std::ranges::views::transform(segments, [](const Rect &seg)
                                                   { return Rectf32::from(seg); }) |
                     std::ranges::to<Rectsf32>();
 
-        auto groups = algo::Algo::group_by_connectivity(segs);
-
-        for (const auto &group : groups)
+        auto tables = table::Grid::build_all(segs);
+        table::Join::run(tables, page);
+        for (const auto &[i, table] : std::ranges::views::enumerate(tables))
         {
-            if (group.size() == 1)
-            {
-                continue;
-            }
-
-            const auto bbox = Rectf32::from(BoundingBox(group)).expand(0.5f).to_cv_rect();
-            cv::rectangle(mat, bbox, cv::Scalar(0, 0, 0xff), 3);
-
-            if (!image_path.empty())
+            for (const auto &cell : table.cells)
             {
-                cv::imwrite(std::format("{}.grouped_segments.png", std::filesystem::path(image_path).stem().string()), mat);
+                std::println("table {} cell ({}, {}) span ({}, {}): {}", i, cell.row, cell.col, cell.row_span, cell.col_span, cell.text);
             }
-
-            continue;
         }
 
-        if (!image_path.empty())
+        if (context)
         {
-            cv::imwrite(std::format("{}.grouped_segments.png", std::filesystem::path(image_path).stem().string()), mat);
+            auto mat = context->bgr().clone();
+            for (const auto &table : tables)
+            {
+                for (const auto &cell : table.cells)
+                {
+                    cv::rectangle(mat, cell.bbox.to_cv_rect(), cv::Scalar(0xff, 0, 0), 1);
+                }
+                cv::rectangle(mat, table.bbox.to_cv_rect(), cv::Scalar(0, 0, 0xff), 3);
+            }
+            DebugWriter::instance().write(std::format("{}.tables.png", context->debug_stem()), std::move(mat));
         }
 
-        return segments;
+        return tables;
     }
 };
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <queue>
+#include <vector>
+
+#include "common.h"
+
+// 不可变的打包 R 树 (Sort-Tile-Recursive)，一次性批量构建，之后只读查询
+// 结果均为构建时传入的矩形的下标；边界相接也算相交，宽或高为 0 的线段同样可以查询
+template <typename T>
+class _SpatialIndex
+{
+public:
+    static constexpr size_t node_capacity = 16;
+
+    _SpatialIndex() = default;
+
+    explicit _SpatialIndex(const _Rects<T> &rects)
+    {
+        build(rects);
+    }
+
+    size_t size() const
+    {
+        return m_items.size();
+    }
+
+    bool empty() const
+    {
+        return m_items.empty();
+    }
+
+    // 与 window 相交的矩形
+    template <typename F>
+    void query(const _Rect<T> &window, F &&visit) const
+    {
+        search([&](const _Rect<T> &bbox)
+               { return overlaps(bbox, window); },
+               [&](const _Rect<T> &box)
+               { return overlaps(box, window); },
+               visit);
+    }
+
+    std::vector<size_t> query(const _Rect<T> &window) const
+    {
+        std::vector<size_t> result;
+        query(window, [&](size_t i)
+              { result.push_back(i); });
+        return result;
+    }
+
+    // 完全位于 window 内的矩形
+    template <typename F>
+    void contained(const _Rect<T> &window, F &&visit) const
+    {
+        search([&](const _Rect<T> &bbox)
+               { return overlaps(bbox, window); },
+               [&](const _Rect<T> &box)
+               { return encloses(window, box); },
+               visit);
+    }
+
+    std::vector<size_t> contained(const _Rect<T> &window) const
+    {
+        std::vector<size_t> result;
+        contained(window, [&](size_t i)
+                  { result.push_back(i); });
+        return result;
+    }
+
+    // 完全包含 rect 的矩形
+    template <typename F>
+    void containing(const _Rect<T> &rect, F &&visit) const
+    {
+        search([&](const _Rect<T> &bbox)
+               { return encloses(bbox, rect); },
+               [&](const _Rect<T> &box)
+               { return encloses(box, rect); },
+               visit);
+    }
+
+    std::vector<size_t> containing(const _Rect<T> &rect) const
+    {
+        std::vector<size_t> result;
+        containing(rect, [&](size_t i)
+                   { result.push_back(i); });
+        return result;
+    }
+
+    // 距离 target 最近的 k 个矩形，按距离从近到远排列，相交的矩形距离为 0
+    std::vector<size_t> nearest(const _Rect<T> &target, size_t k) const
+    {
+        std::vector<size_t> result;
+        if (empty() || k == 0)
+        {
+            return result;
+        }
+
+        // 最优优先搜索：节点的距离是其包围盒的距离，不会大于其中任何矩形的距离
+        struct Entry
+        {
+            double distance;
+            size_t index;
+            size_t level; // 0 表示矩形本身，否则为节点所在层数 + 1
+
+            bool operator>(const Entry &other) const
+            {
+                return distance > other.distance;
+            }
+        };
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+        queue.push({distance(m_nodes.back().bbox, target), m_nodes.size() - 1, m_levels.size()});
+
+        while (!queue.empty() && result.size() < k)
+        {
+            const auto entry = queue.top();
+            queue.pop();
+            if (entry.level == 0)
+            {
+                result.push_back(m_items[entry.index]);
+                continue;
+            }
+
+            const auto &node = m_nodes[entry.index];
+            for (auto i = node.begin; i < node.end; ++i)
+            {
+                const auto &bbox = entry.level == 1 ? m_boxes[i] : m_nodes[i].bbox;
+                queue.push({distance(bbox, target), i, entry.level - 1});
+            }
+        }
+        return result;
+    }
+
+    static bool overlaps(const _Rect<T> &a, const _Rect<T> &b)
+    {
+        return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+    }
+
+    static bool encloses(const _Rect<T> &outer, const _Rect<T> &inner)
+    {
+        return outer.x0 <= inner.x0 && outer.y0 <= inner.y0 && inner.x1 <= outer.x1 && inner.y1 <= outer.y1;
+    }
+
+    // 两个矩形之间最短距离的平方
+    static double distance(const _Rect<T> &a, const _Rect<T> &b)
+    {
+        const auto dx = std::max({0.0, double(a.x0) - double(b.x1), double(b.x0) - double(a.x1)});
+        const auto dy = std::max({0.0, double(a.y0) - double(b.y1), double(b.y0) - double(a.y1)});
+        return dx * dx + dy * dy;
+    }
+
+private:
+    // 子节点在下一层 (叶子节点则在 m_boxes 中) 连续存放，[begin, end)
+    struct Node
+    {
+        _Rect<T> bbox;
+        size_t begin;
+        size_t end;
+    };
+
+    void build(const _Rects<T> &rects)
+    {
+        if (rects.empty())
+        {
+            return;
+        }
+
+        m_items.resize(rects.size());
+        std::iota(m_items.begin(), m_items.end(), size_t(0));
+        tile(m_items, [&](size_t i) -> const _Rect<T> &
+             { return rects[i]; });
+
+        m_boxes.reserve(rects.size());
+        for (const auto i : m_items)
+        {
+            m_boxes.push_back(rects[i]);
+        }
+
+        // 叶子层
+        std::vector<Node> level;
+        for (size_t begin = 0; begin < m_boxes.size(); begin += node_capacity)
+        {
+            const auto end = std::min(begin + node_capacity, m_boxes.size());
+            level.push_back({bounds(m_boxes.begin() + begin, m_boxes.begin() + end), begin, end});
+        }
+
+        // 逐层向上打包，直到只剩根节点
+        while (true)
+        {
+            std::vector<size_t> order(level.size());
+            std::iota(order.begin(), order.end(), size_t(0));
+            tile(order, [&](size_t i) -> const _Rect<T> &
+                 { return level[i].bbox; });
+
+            const auto offset = m_nodes.size();
+            m_levels.push_back(offset);
+            for (const auto i : order)
+            {
+                m_nodes.push_back(level[i]);
+            }
+            if (order.size() == 1)
+            {
+                break;
+            }
+
+            std::vector<Node> parents;
+            for (size_t begin = 0; begin < order.size(); begin += node_capacity)
+            {
+                const auto end = std::min(begin + node_capacity, order.size());
+                auto bbox = m_nodes[offset + begin].bbox;
+                for (auto i = begin + 1; i < end; ++i)
+                {
+                    bbox = merge(bbox, m_nodes[offset + i].bbox);
+                }
+                parents.push_back({bbox, offset + begin, offset + end});
+            }
+            level = std::move(parents);
+        }
+    }
+
+    // STR 排序：按中心 x 分成 ceil(sqrt(叶子数)) 个竖条，每个竖条内按中心 y 排序
+    template <typename Box>
+    static void tile(std::vector<size_t> &order, Box &&box)
+    {
+        const auto count = order.size();
+        const auto leaves = (count + node_capacity - 1) / node_capacity;
+        const auto slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(leaves))));
+        const auto slice_size = slices * node_capacity;
+
+        std::ranges::sort(order, {}, [&](size_t i)
+                          { return double(box(i).x0) + double(box(i).x1); });
+        for (size_t begin = 0; begin < count; begin += slice_size)
+        {
+            const auto end = std::min(begin + slice_size, count);
+            std::ranges::sort(order.begin() + begin, order.begin() + end, {}, [&](size_t i)
+                              { return double(box(i).y0) + double(box(i).y1); });
+        }
+    }
+
+    template <typename NodePred, typename ItemPred, typename F>
+    void search(NodePred &&node_pred, ItemPred &&item_pred, F &visit) const
+    {
+        if (empty() || !node_pred(m_nodes.back().bbox))
+        {
+            return;
+        }
+
+        // (节点下标, 层数)，叶子层为 0
+        std::vector<std::pair<size_t, size_t>> stack{{m_nodes.size() - 1, m_levels.size() - 1}};
+        while (!stack.empty())
+        {
+            const auto [index, level] = stack.back();
+            stack.pop_back();
+
+            const auto &node = m_nodes[index];
+            for (auto i = node.begin; i < node.end; ++i)
+            {
+                if (level == 0)
+                {
+                    if (item_pred(m_boxes[i]))
+                    {
+                        visit(m_items[i]);
+                    }
+                }
+                else if (node_pred(m_nodes[i].bbox))
+                {
+                    stack.emplace_back(i, level - 1);
+                }
+            }
+        }
+    }
+
+    static _Rect<T> merge(const _Rect<T> &a, const _Rect<T> &b)
+    {
+        return {std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+    }
+
+    template <typename It>
+    static _Rect<T> bounds(It first, It last)
+    {
+        auto bbox = *first;
+        for (++first; first != last; ++first)
+        {
+            bbox = merge(bbox, *first);
+        }
+        return bbox;
+    }
+
+    std::vector<_Rect<T>> m_boxes; // 按叶子顺序排列的矩形
+    std::vector<size_t> m_items;   // 叶子顺序到原始下标
+    std::vector<Node> m_nodes;     // 从叶子层到根逐层存放，根节点在最后
+    std::vector<size_t> m_levels;  // 每一层在 m_nodes 中的起始位置
+};
+
+using SpatialIndex = _SpatialIndex<int>;
+using SpatialIndexf32 = _SpatialIndex<float>;
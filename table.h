@@ -0,0 +1,356 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include "algo.h"
+#include "common.h"
+#include "fixed2_debugger.h"
+#include "spatial_index.h"
+
+namespace table
+{
+
+    // 表格中的一个单元格，row/col 为左上角所在的行列，合并单元格的 span 大于 1
+    // words/chars/text 由 Join 填写：中心落在单元格内的词和字在 Page 中的下标，以及按阅读顺序拼接的文本
+    struct Cell
+    {
+        int row{};
+        int col{};
+        int row_span{1};
+        int col_span{1};
+        Rect bbox;
+        std::vector<uint32_t> words;
+        std::vector<uint32_t> chars;
+        std::string text;
+    };
+
+    // 由一组相连的表格线重建的网格：xs/ys 为对齐后的竖线、横线坐标 (升序)，
+    // 共 ys.size() - 1 行、xs.size() - 1 列，cells 按左上角先行后列排列
+    struct Table
+    {
+        Rect bbox;
+        std::vector<int> xs;
+        std::vector<int> ys;
+        std::vector<Cell> cells;
+        std::vector<int> grid; // 每个基本格子所属的单元格下标，rows() * cols() 个，按行存放
+
+        // 点所在单元格的下标，两次二分查找；落在表格外时返回 -1，右侧和下侧的外框不算在表格内
+        int cell_at(int x, int y) const
+        {
+            const auto col = static_cast<int>(std::ranges::upper_bound(xs, x) - xs.begin()) - 1;
+            const auto row = static_cast<int>(std::ranges::upper_bound(ys, y) - ys.begin()) - 1;
+            if (col < 0 || col >= cols() || row < 0 || row >= rows())
+            {
+                return -1;
+            }
+            return grid[static_cast<size_t>(row) * cols() + col];
+        }
+
+        int rows() const
+        {
+            return static_cast<int>(ys.size()) - 1;
+        }
+
+        int cols() const
+        {
+            return static_cast<int>(xs.size()) - 1;
+        }
+    };
+
+    class Grid
+    {
+    public:
+        // 对齐线条、判断端点是否落在某条线上时允许的误差 (像素)
+        static constexpr float default_tolerance = 3.0f;
+
+        // 线段先按连通性分组，每个至少包含两条横线和两条竖线的组重建为一个表格
+        static std::vector<Table> build_all(const Rectsf32 &segments, float tolerance = default_tolerance)
+        {
+            std::vector<Table> tables;
+            for (const auto &group : algo::Algo::group_by_connectivity(segments, tolerance, tolerance))
+            {
+                if (auto table = build(group, tolerance))
+                {
+                    tables.push_back(std::move(*table));
+                }
+            }
+            return tables;
+        }
+
+        // 1. 横线按 y、竖线按 x 排序后把相距不超过 tolerance 的坐标聚成一条网格线
+        // 2. 每条线覆盖网格线上的一段区间，用差分数组标记网格边 (格点之间的线段) 是否存在
+        // 3. 相邻的基本格子之间没有边时用并查集合并，每个集合就是一个 (可能跨行跨列的) 单元格
+        // 排序为 O(n log n)，其余部分与线段数和网格大小成线性
+        static std::optional<Table> build(std::span<const Rectf32> group, float tolerance = default_tolerance)
+        {
+            std::vector<Rule> horizontals, verticals;
+            for (const auto &seg : group)
+            {
+                if (seg.is_vertical())
+                {
+                    verticals.push_back({(seg.x0 + seg.x1) / 2, std::min(seg.y0, seg.y1), std::max(seg.y0, seg.y1)});
+                }
+                else
+                {
+                    horizontals.push_back({(seg.y0 + seg.y1) / 2, std::min(seg.x0, seg.x1), std::max(seg.x0, seg.x1)});
+                }
+            }
+
+            Table table;
+            table.ys = snap(horizontals, tolerance);
+            table.xs = snap(verticals, tolerance);
+            if (table.ys.size() < 2 || table.xs.size() < 2)
+            {
+                return std::nullopt;
+            }
+
+            const auto rows = table.rows(), cols = table.cols();
+            // h_edges[r * cols + c]：横线 r 上 xs[c]..xs[c+1] 之间有线
+            // v_edges[c * rows + r]：竖线 c 上 ys[r]..ys[r+1] 之间有线
+            const auto h_edges = edges(horizontals, table.ys, table.xs, tolerance);
+            const auto v_edges = edges(verticals, table.xs, table.ys, tolerance);
+
+            algo::DisjointSet cells(static_cast<size_t>(rows) * cols);
+            const auto index = [&](int r, int c)
+            { return static_cast<size_t>(r) * cols + c; };
+            for (int r = 0; r < rows; ++r)
+            {
+                for (int c = 0; c < cols; ++c)
+                {
+                    if (c + 1 < cols && !v_edges[static_cast<size_t>(c + 1) * rows + r])
+                    {
+                        cells.unite(index(r, c), index(r, c + 1));
+                    }
+                    if (r + 1 < rows && !h_edges[static_cast<size_t>(r + 1) * cols + c])
+                    {
+                        cells.unite(index(r, c), index(r + 1, c));
+                    }
+                }
+            }
+
+            // 按行优先遍历，每个集合第一次出现的位置就是它的左上角
+            std::vector<int> cell_of(cells.size(), -1);
+            table.grid.resize(cells.size());
+            for (int r = 0; r < rows; ++r)
+            {
+                for (int c = 0; c < cols; ++c)
+                {
+                    auto &cell = cell_of[cells.find(index(r, c))];
+                    table.grid[index(r, c)] = cell < 0 ? static_cast<int>(table.cells.size()) : cell;
+                    if (cell < 0)
+                    {
+                        cell = static_cast<int>(table.cells.size());
+                        table.cells.push_back({r, c, 1, 1});
+                        continue;
+                    }
+                    auto &merged = table.cells[cell];
+                    merged.row_span = std::max(merged.row_span, r - merged.row + 1);
+                    merged.col_span = std::max(merged.col_span, c - merged.col + 1);
+                }
+            }
+            for (auto &cell : table.cells)
+            {
+                cell.bbox = {table.xs[cell.col], table.ys[cell.row], table.xs[cell.col + cell.col_span], table.ys[cell.row + cell.row_span]};
+            }
+
+            table.bbox = {table.xs.front(), table.ys.front(), table.xs.back(), table.ys.back()};
+            return table;
+        }
+
+    private:
+        // 一条横线 (或竖线)：pos 为 y (或 x)，[begin, end] 为沿线方向的范围
+        struct Rule
+        {
+            float pos;
+            float begin;
+            float end;
+            int line{}; // 对齐后所在网格线的下标
+        };
+
+        // 按 pos 排序并聚类，返回每一类的平均坐标，同时填写每条线所属的网格线
+        static std::vector<int> snap(std::vector<Rule> &rules, float tolerance)
+        {
+            std::ranges::sort(rules, {}, &Rule::pos);
+
+            std::vector<int> lines;
+            for (size_t begin = 0; begin < rules.size();)
+            {
+                auto end = begin + 1;
+                auto sum = rules[begin].pos;
+                while (end < rules.size() && rules[end].pos - rules[end - 1].pos <= tolerance)
+                {
+                    sum += rules[end++].pos;
+                }
+                for (auto i = begin; i < end; ++i)
+                {
+                    rules[i].line = static_cast<int>(lines.size());
+                }
+                lines.push_back(static_cast<int>(std::lround(sum / (end - begin))));
+                begin = end;
+            }
+            return lines;
+        }
+
+        // 同一网格线上首尾相接 (间隔不超过 tolerance) 的线合并成一条，断开的表格线才能覆盖完整的网格边
+        static std::vector<Rule> join(std::vector<Rule> rules, float tolerance)
+        {
+            std::ranges::sort(rules, [](const Rule &a, const Rule &b)
+                              { return std::tie(a.line, a.begin) < std::tie(b.line, b.begin); });
+
+            std::vector<Rule> joined;
+            for (const auto &rule : rules)
+            {
+                if (!joined.empty() && joined.back().line == rule.line && rule.begin <= joined.back().end + tolerance)
+                {
+                    joined.back().end = std::max(joined.back().end, rule.end);
+                    continue;
+                }
+                joined.push_back(rule);
+            }
+            return joined;
+        }
+
+        // 每条线在垂直方向的网格线 cross 上覆盖的格点区间，用差分数组累加后得到每一段网格边是否存在
+        // 结果按 [网格线][段] 存放，lines.size() * (cross.size() - 1) 个
+        static std::vector<uint8_t> edges(const std::vector<Rule> &rules, const std::vector<int> &lines, const std::vector<int> &cross, float tolerance)
+        {
+            const auto segments = cross.size() - 1;
+            std::vector<int> diff(lines.size() * (segments + 1));
+            for (const auto &rule : join(rules, tolerance))
+            {
+                // 覆盖的第一个和最后一个格点
+                const auto first = std::ranges::lower_bound(cross, rule.begin - tolerance, {}, [](int x)
+                                                            { return float(x); }) -
+                                   cross.begin();
+                const auto last = std::ranges::upper_bound(cross, rule.end + tolerance, {}, [](int x)
+                                                           { return float(x); }) -
+                                  cross.begin() - 1;
+                if (last <= first)
+                {
+                    continue;
+                }
+                const auto base = static_cast<size_t>(rule.line) * (segments + 1);
+                ++diff[base + first];
+                --diff[base + last];
+            }
+
+            std::vector<uint8_t> result(lines.size() * segments);
+            for (size_t line = 0; line < lines.size(); ++line)
+            {
+                int covered = 0;
+                for (size_t s = 0; s < segments; ++s)
+                {
+                    covered += diff[line * (segments + 1) + s];
+                    result[line * segments + s] = covered > 0;
+                }
+            }
+            return result;
+        }
+    };
+
+
+    // 把 Page 中的词和字分配到中心所在的单元格：表格按包围盒建 R 树，
+    // 单元格在表格的网格上二分查找，每个字 O(log) 时间，整页近似线性
+    // Page 按行、词、字的识别顺序遍历，所以每个单元格内的文本保持阅读顺序：
+    // 同一行的不同词之间插入空格，不同行之间插入换行
+    class Join
+    {
+    public:
+        static void run(std::vector<Table> &tables, const fixed2_debugger::Page &page)
+        {
+            for (auto &table : tables)
+            {
+                for (auto &cell : table.cells)
+                {
+                    cell.words.clear();
+                    cell.chars.clear();
+                    cell.text.clear();
+                }
+            }
+            if (tables.empty() || page.empty())
+            {
+                return;
+            }
+
+            Rects bboxes;
+            bboxes.reserve(tables.size());
+            for (const auto &table : tables)
+            {
+                bboxes.push_back(table.bbox);
+            }
+            const SpatialIndex index(bboxes);
+
+            // 返回 (表格, 单元格)，不在任何单元格内时表格为 nullptr
+            const auto locate = [&](const Rect &bbox) -> std::pair<Table *, int>
+            {
+                const auto x = (bbox.x0 + bbox.x1) / 2, y = (bbox.y0 + bbox.y1) / 2;
+                std::pair<Table *, int> found{nullptr, -1};
+                index.query(Rect{x, y, x, y}, [&](size_t i)
+                            {
+                    if (found.first)
+                    {
+                        return;
+                    }
+                    if (const auto cell = tables[i].cell_at(x, y); cell >= 0)
+                    {
+                        found = {&tables[i], cell};
+                    } });
+                return found;
+            };
+
+            // 每个单元格最后写入的字所在的行和词，用于决定分隔符
+            struct Cursor
+            {
+                const fixed2_debugger::Line *line{};
+                const fixed2_debugger::Word *word{};
+            };
+            std::vector<std::vector<Cursor>> cursors(tables.size());
+            for (size_t i = 0; i < tables.size(); ++i)
+            {
+                cursors[i].resize(tables[i].cells.size());
+            }
+
+            const auto words = page.words();
+            const auto chars = page.chars();
+            for (const auto &line : page.lines())
+            {
+                for (const auto &word : page.words_of(line))
+                {
+                    if (const auto [table, cell] = locate(word.bbox); table)
+                    {
+                        table->cells[cell].words.push_back(static_cast<uint32_t>(&word - words.data()));
+                    }
+
+                    for (const auto &ch : page.chars_of(word))
+                    {
+                        const auto [table, cell] = locate(ch.bbox);
+                        if (!table)
+                        {
+                            continue;
+                        }
+                        auto &target = table->cells[cell];
+                        auto &cursor = cursors[table - tables.data()][cell];
+                        if (cursor.line && cursor.line != &line)
+                        {
+                            target.text += '\n';
+                        }
+                        else if (cursor.word && cursor.word != &word)
+                        {
+                            target.text += ' ';
+                        }
+                        cursor = {&line, &word};
+                        target.chars.push_back(static_cast<uint32_t>(&ch - chars.data()));
+                        target.text += page.text_of(ch);
+                    }
+                }
+            }
+        }
+    };
+
+}
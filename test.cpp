@@ -1,5 +1,22 @@
 #include <gtest/gtest.h>
 
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "algo.h"
+#include "archive.h"
+#include "flat_hash.h"
+#include "glyph_cache.h"
+#include "mapped_file.h"
+#include "normalize.h"
+#include "page_context.h"
+#include "spatial_index.h"
+#include "table.h"
 #include "common.h"
 
 
@@ -19,6 +36,577 @@ TEST(AddTest, PositiveNos) {
     EXPECT_TRUE(r1.nearby(r2, 1));
 }
 
+TEST(ArchiveTest, AppendAndRandomAccess) {
+    const auto path = std::filesystem::temp_directory_path() / "images_process_archive_test.bin";
+    std::filesystem::remove(path);
+
+    fixed2_debugger::Page page1;
+    page1.append_char({0, 0, 100, 20}, {0, 0, 40, 20}, {0, 0, 20, 20}, "中", 20);
+    page1.append_char({0, 0, 100, 20}, {0, 0, 40, 20}, {20, 0, 40, 20}, "文", 20);
+    page1.append_char({0, 0, 100, 20}, {50, 0, 100, 20}, {50, 0, 60, 20}, "a", 12);
+    fixed2_debugger::Page page2;
+    page2.append_char({0, 30, 10, 40}, {0, 30, 10, 40}, {0, 30, 10, 40}, "b", 10);
+
+    {
+        archive::Writer writer(path);
+        EXPECT_EQ(writer.append(page1), 0);
+    }
+    {
+        // 重新打开后继续追加
+        archive::Writer writer(path);
+        EXPECT_EQ(writer.append(page2, 3), 1);
+    }
+
+    archive::Reader reader(path);
+    ASSERT_TRUE(reader);
+    ASSERT_EQ(reader.size(), 2);
+
+    const auto view = reader.page(0);
+    ASSERT_EQ(view.lines.size(), 1);
+    ASSERT_EQ(view.words.size(), 2);
+    ASSERT_EQ(view.chars.size(), 3);
+    EXPECT_EQ(view.text_of(view.chars[1]), "文");
+    EXPECT_EQ(view.chars_of(view.words[1]).front().bbox, (Rect{50, 0, 60, 20}));
+
+    EXPECT_EQ(view.page_number, 0);
+    EXPECT_EQ(reader.page(1).page_number, 3);
+
+    const auto restored = reader.page(1).to_page();
+    ASSERT_EQ(restored.lines().size(), 1);
+    EXPECT_EQ(restored.text_of(restored.chars()[0]), "b");
+    EXPECT_EQ(restored.lines()[0].bbox, (Rect{0, 30, 10, 40}));
+
+    std::filesystem::remove(path);
+}
+
+TEST(ArchiveTest, DiscardRestoresPreviousContents) {
+    const auto path = std::filesystem::temp_directory_path() / "images_process_archive_discard_test.bin";
+    std::filesystem::remove(path);
+
+    fixed2_debugger::Page page;
+    page.append_char({0, 0, 10, 10}, {0, 0, 10, 10}, {0, 0, 10, 10}, "a", 10);
+    {
+        // 新建的文件被删除
+        archive::Writer writer(path);
+        writer.append(page);
+        writer.discard();
+    }
+    EXPECT_FALSE(std::filesystem::exists(path));
+
+    {
+        archive::Writer writer(path);
+        writer.append(page);
+    }
+    {
+        // 追加的页被丢弃，原有的页保持可读
+        archive::Writer writer(path);
+        writer.append(page, 1);
+        writer.append(page, 2);
+        writer.discard();
+    }
+    archive::Reader reader(path);
+    ASSERT_TRUE(reader);
+    ASSERT_EQ(reader.size(), 1);
+    EXPECT_EQ(reader.page(0).text, "a");
+
+    std::filesystem::remove(path);
+}
+
+TEST(ArchiveTest, RejectsCorruptedCounts) {
+    const auto path = std::filesystem::temp_directory_path() / "images_process_archive_corrupt_test.bin";
+    std::filesystem::remove(path);
+
+    fixed2_debugger::Page page;
+    page.append_char({0, 0, 10, 10}, {0, 0, 10, 10}, {0, 0, 10, 10}, "a", 10);
+    {
+        archive::Writer writer(path);
+        writer.append(page);
+    }
+
+    // 第一页从 8 字节边界开始，把头部的 char_count 改成远超这一页的值
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(archive::align8(sizeof(archive::FileHeader)) + offsetof(archive::PageHeader, char_count)));
+        const uint32_t count = 0xFFFFFFFF;
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    }
+
+    archive::Reader reader(path);
+    ASSERT_TRUE(reader);
+    ASSERT_EQ(reader.size(), 1);
+    const auto view = reader.page(0);
+    EXPECT_TRUE(view.lines.empty());
+    EXPECT_TRUE(view.chars.empty());
+    EXPECT_TRUE(view.text.empty());
+
+    std::filesystem::remove(path);
+}
+
+TEST(MappedFileTest, MapsFilesAndReadsPipes) {
+    const std::string payload(100000, 'x');
+    const auto path = std::filesystem::temp_directory_path() / "images_process_mapped_file_test.bin";
+    std::ofstream(path, std::ios::binary) << payload;
+
+    const auto mapped = MappedFile::open(path.string());
+    ASSERT_TRUE(mapped);
+    EXPECT_EQ(std::string_view(reinterpret_cast<const char *>(mapped->data()), mapped->size()), payload);
+    std::filesystem::remove(path);
+
+    // 管道不能映射，一次性读入内存；数据小于管道缓冲区，写完关闭写端后再读
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    const auto small = payload.substr(0, 30000);
+    ASSERT_EQ(write(fds[1], small.data(), small.size()), ssize_t(small.size()));
+    close(fds[1]);
+    const auto piped = MappedFile::open("/proc/self/fd/" + std::to_string(fds[0]));
+    close(fds[0]);
+    ASSERT_TRUE(piped);
+    EXPECT_EQ(std::string_view(reinterpret_cast<const char *>(piped->data()), piped->size()), small);
+
+    EXPECT_EQ(MappedFile::from_buffer({std::byte{1}, std::byte{2}})->size(), 2);
+}
+
+TEST(GlyphCacheTest, BlendClipsAtLeftAndTopEdges) {
+    GlyphCache::Glyph glyph;
+    glyph.alpha = cv::Mat(3, 3, CV_8UC1, cv::Scalar(255));
+    cv::Mat bitmap(4, 4, CV_8UC3, cv::Scalar(255, 255, 255));
+
+    // 左上角在 (-1, -2)：只有字形的右下 2x1 落在画布内
+    GlyphCache::blend(bitmap, glyph, -1, -2, cv::Scalar(0, 0, 0));
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            const auto expected = (y < 1 && x < 2) ? 0 : 255;
+            EXPECT_EQ(bitmap.at<cv::Vec3b>(y, x)[0], expected) << x << "," << y;
+        }
+    }
+}
+
+TEST(GlyphCacheTest, CopiesBottomUpBitmapsTopDown) {
+    // 自下而上存放的 2 行位图：内存中第一行是最下面一行
+    std::array<unsigned char, 8> buffer{3, 4, 0, 0, 1, 2, 0, 0};
+    FT_Bitmap bitmap{};
+    bitmap.rows = 2;
+    bitmap.width = 2;
+    bitmap.pitch = -4;
+    bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+    bitmap.buffer = buffer.data();
+    auto alpha = GlyphCache::copy_bitmap(bitmap);
+    ASSERT_EQ(alpha.rows, 2);
+    EXPECT_EQ(alpha.at<uint8_t>(0, 0), 1);
+    EXPECT_EQ(alpha.at<uint8_t>(0, 1), 2);
+    EXPECT_EQ(alpha.at<uint8_t>(1, 0), 3);
+
+    bitmap.pitch = 4;
+    alpha = GlyphCache::copy_bitmap(bitmap);
+    EXPECT_EQ(alpha.at<uint8_t>(0, 0), 3);
+    EXPECT_EQ(alpha.at<uint8_t>(1, 1), 2);
+}
+
+TEST(GlyphCacheTest, ExpandsMonoBitmaps) {
+    // 10 像素宽的 MONO 位图每行 2 个字节，只读 pitch 范围内的数据
+    std::array<unsigned char, 4> buffer{0b10100000, 0b01000000, 0b00000001, 0b10000000};
+    FT_Bitmap bitmap{};
+    bitmap.rows = 2;
+    bitmap.width = 10;
+    bitmap.pitch = 2;
+    bitmap.pixel_mode = FT_PIXEL_MODE_MONO;
+    bitmap.buffer = buffer.data();
+    const auto alpha = GlyphCache::copy_bitmap(bitmap);
+    ASSERT_EQ(alpha.rows, 2);
+    ASSERT_EQ(alpha.cols, 10);
+    const std::array<std::array<int, 10>, 2> expected{{{255, 0, 255, 0, 0, 0, 0, 0, 0, 255}, {0, 0, 0, 0, 0, 0, 0, 255, 255, 0}}};
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 10; ++x) {
+            EXPECT_EQ(alpha.at<uint8_t>(y, x), expected[y][x]) << x << "," << y;
+        }
+    }
+}
+
+TEST(PageTest, FlatReflowMergesNearbyWords) {
+    fixed2_debugger::Page page;
+    page.append_char({0, 0, 100, 20}, {0, 0, 20, 20}, {0, 0, 10, 20}, "a", 20);
+    page.append_char({0, 0, 100, 20}, {0, 0, 20, 20}, {10, 0, 20, 20}, "b", 20);
+    page.append_char({0, 0, 100, 20}, {22, 0, 40, 20}, {22, 0, 40, 20}, "c", 20);
+    page.append_char({0, 30, 100, 50}, {0, 30, 10, 50}, {0, 30, 10, 50}, "d", 20);
+    ASSERT_EQ(page.lines().size(), 2);
+    ASSERT_EQ(page.words().size(), 3);
+
+    auto copy = page;
+    copy.reflow();
+    ASSERT_EQ(copy.words().size(), 2);
+    const auto &line = copy.lines()[0];
+    ASSERT_EQ(copy.words_of(line).size(), 1);
+    const auto &word = copy.words_of(line)[0];
+    EXPECT_EQ(word.bbox, (Rect{0, 0, 40, 20}));
+    const auto chars = copy.chars_of(word);
+    ASSERT_EQ(chars.size(), 3);
+    EXPECT_EQ(chars[0].bbox, (Rect{0, 0, 9, 20}));
+    EXPECT_EQ(copy.text_of(chars[2]), "c");
+    EXPECT_EQ(copy.words_of(copy.lines()[1]).size(), 1);
+
+    // 原页面不受影响，clear 之后可以继续使用
+    EXPECT_EQ(page.words().size(), 3);
+    page.clear();
+    EXPECT_TRUE(page.empty());
+    page.append(copy);
+    EXPECT_EQ(page.text(), "abcd");
+}
+
+TEST(PageTest, ParallelReflowKeepsLineOrder) {
+    // 行数足够多时按行并行重排，结果与逐行处理一致
+    fixed2_debugger::Page page;
+    for (int y = 0; y < 300 * 30; y += 30) {
+        const Rect line{0, y, 200, y + 20};
+        page.append_char(line, {0, y, 20, y + 20}, {0, y, 20, y + 20}, "a", 20);
+        page.append_char(line, {25, y, 45, y + 20}, {25, y, 45, y + 20}, "b", 20);
+        page.append_char(line, {150, y, 170, y + 20}, {150, y, 170, y + 20}, "c", 20);
+    }
+    page.reflow(4);
+
+    ASSERT_EQ(page.lines().size(), 300);
+    ASSERT_EQ(page.words().size(), 600);
+    for (const auto &line : page.lines()) {
+        const auto words = page.words_of(line);
+        ASSERT_EQ(words.size(), 2);
+        EXPECT_EQ(page.chars_of(words[0]).size(), 2);
+        EXPECT_EQ(words[0].bbox, (Rect{0, line.bbox.y0, 45, line.bbox.y1}));
+        EXPECT_EQ(page.text_of(page.chars_of(words[1])[0]), "c");
+    }
+}
+
+TEST(PageTest, ParallelReflowMatchesSerial) {
+    // 每行的词数、间距、字高都随机，有的行所有词都会合并，有的行一个都不合并
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> words_per_line(1, 6), chars_per_word(1, 4), gap(0, 30), width(5, 15), jitter(0, 3);
+    fixed2_debugger::Page page;
+    for (int y = 0; y < 500 * 30; y += 30) {
+        const auto count = words_per_line(rng);
+        int x = 0;
+        for (int w = 0; w < count; ++w) {
+            const auto word_x0 = x;
+            std::vector<Rect> chars;
+            for (int c = chars_per_word(rng); c > 0; --c) {
+                const auto cw = width(rng);
+                chars.push_back({x, y + jitter(rng), x + cw, y + 20 - jitter(rng)});
+                x += cw;
+            }
+            for (const auto &ch : chars) {
+                page.append_char({0, y, 1000, y + 20}, {word_x0, y, x, y + 20}, ch, "x", 20);
+            }
+            x += gap(rng);
+        }
+    }
+
+    auto serial = page, parallel = page;
+    serial.reflow(1);
+    parallel.reflow(4);
+
+    ASSERT_EQ(parallel.lines().size(), serial.lines().size());
+    ASSERT_EQ(parallel.words().size(), serial.words().size());
+    ASSERT_EQ(parallel.chars().size(), serial.chars().size());
+    for (size_t i = 0; i < serial.lines().size(); ++i) {
+        EXPECT_EQ(parallel.lines()[i].bbox, serial.lines()[i].bbox);
+        EXPECT_EQ(parallel.lines()[i].word_begin, serial.lines()[i].word_begin);
+        EXPECT_EQ(parallel.lines()[i].word_end, serial.lines()[i].word_end);
+    }
+    for (size_t i = 0; i < serial.words().size(); ++i) {
+        EXPECT_EQ(parallel.words()[i].bbox, serial.words()[i].bbox);
+        EXPECT_EQ(parallel.words()[i].char_begin, serial.words()[i].char_begin);
+        EXPECT_EQ(parallel.words()[i].char_end, serial.words()[i].char_end);
+    }
+    for (size_t i = 0; i < serial.chars().size(); ++i) {
+        EXPECT_EQ(parallel.chars()[i].bbox, serial.chars()[i].bbox);
+    }
+    EXPECT_LT(serial.words().size(), page.words().size());
+}
+
+TEST(AlgoTest, RectsIntersectionMatchesBruteForce) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> pos(0, 1000);
+    std::uniform_real_distribution<float> len(1, 200);
+    // 线段的端点取在整数格上，才会出现首尾相接、十字交叉和重合的情况
+    std::uniform_int_distribution<int> grid(0, 50);
+    std::uniform_int_distribution<int> span(0, 10);
+
+    for (int round = 0; round < 20; ++round) {
+        _Rects<float> rects;
+        for (int i = 0; i < 200; ++i) {
+            const auto x = pos(rng), y = pos(rng);
+            rects.push_back({x, y, x + len(rng), y + len(rng)});
+        }
+        // 零宽的竖线、零高的横线和单个点
+        for (int i = 0; i < 200; ++i) {
+            const auto x = float(grid(rng) * 20), y = float(grid(rng) * 20);
+            switch (i % 3) {
+            case 0:
+                rects.push_back({x, y, x, y + span(rng) * 20.0f});
+                break;
+            case 1:
+                rects.push_back({x, y, x + span(rng) * 20.0f, y});
+                break;
+            default:
+                rects.push_back({x, y, x, y});
+                break;
+            }
+        }
+
+        std::vector<algo::Algo::RectContext> edges;
+        for (size_t i = 0; i < rects.size(); ++i) {
+            edges.emplace_back(2 * i, rects[i], rects[i].x0);
+            edges.emplace_back(2 * i + 1, rects[i], rects[i].x1);
+        }
+        std::ranges::sort(edges, {}, [](const auto &e) { return std::pair(std::get<2>(e), std::get<0>(e) & 1); });
+
+        std::set<std::pair<size_t, size_t>> found;
+        algo::Algo::solve_rects_intersection(edges, [&](size_t i, size_t j) {
+            if (i != j) {
+                found.emplace(std::min(i, j), std::max(i, j));
+            }
+        });
+
+        // 闭区间：只有边或端点重合也算相交
+        std::set<std::pair<size_t, size_t>> expected;
+        for (size_t i = 0; i < rects.size(); ++i) {
+            for (size_t j = i + 1; j < rects.size(); ++j) {
+                const auto &a = rects[i], &b = rects[j];
+                if (a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1) {
+                    expected.emplace(i, j);
+                }
+            }
+        }
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST(AlgoTest, DegenerateSegmentsConnect) {
+    // 十字交叉、T 形相接、首尾相接的零宽线段都连通，分开的不连通
+    const _Rects<float> segs{{0, 10, 20, 10}, {10, 0, 10, 20}, {20, 10, 20, 30}, {20, 30, 40, 30}, {50, 30, 60, 30}};
+    const auto groups = algo::Algo::group_by_connectivity(segs);
+    ASSERT_EQ(groups.size(), 2);
+    EXPECT_EQ(groups[0].size(), 4);
+    EXPECT_EQ(groups[1].size(), 1);
+}
+
+TEST(AlgoTest, GroupByConnectivity) {
+    const _Rects<float> segs{{0, 0, 10, 10}, {100, 100, 110, 110}, {5, 5, 15, 15}, {14, 0, 20, 6}, {112, 100, 120, 110}};
+
+    const auto groups = algo::Algo::group_by_connectivity(segs);
+    ASSERT_EQ(groups.size(), 3);
+    EXPECT_EQ(groups[0].size(), 3);
+    EXPECT_EQ(groups[1].size(), 1);
+    EXPECT_EQ(groups[2].size(), 1);
+
+    // 放宽 dx 之后右边两个框也连通
+    EXPECT_EQ(algo::Algo::group_by_connectivity(segs, 2, 0).size(), 2);
+}
+
+TEST(SpatialIndexTest, MatchesLinearScan) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pos(0, 2000);
+    std::uniform_int_distribution<int> len(0, 60);
+
+    Rects rects;
+    for (int i = 0; i < 1000; ++i) {
+        const auto x = pos(rng), y = pos(rng);
+        rects.push_back({x, y, x + len(rng), y + len(rng)});
+    }
+    const SpatialIndex index(rects);
+    ASSERT_EQ(index.size(), rects.size());
+
+    const auto sorted = [](std::vector<size_t> v) {
+        std::ranges::sort(v);
+        return v;
+    };
+    for (int round = 0; round < 50; ++round) {
+        const auto x = pos(rng), y = pos(rng);
+        const Rect window{x, y, x + 5 * len(rng), y + 5 * len(rng)};
+
+        std::vector<size_t> overlapping, inside, enclosing;
+        for (size_t i = 0; i < rects.size(); ++i) {
+            if (SpatialIndex::overlaps(rects[i], window)) {
+                overlapping.push_back(i);
+            }
+            if (SpatialIndex::encloses(window, rects[i])) {
+                inside.push_back(i);
+            }
+            if (SpatialIndex::encloses(rects[i], window)) {
+                enclosing.push_back(i);
+            }
+        }
+        EXPECT_EQ(sorted(index.query(window)), overlapping);
+        EXPECT_EQ(sorted(index.contained(window)), inside);
+        EXPECT_EQ(sorted(index.containing(window)), enclosing);
+
+        // 最近的 k 个：距离序列与线性扫描一致
+        std::vector<double> distances;
+        for (const auto &r : rects) {
+            distances.push_back(SpatialIndex::distance(r, window));
+        }
+        std::ranges::sort(distances);
+        const auto nearest = index.nearest(window, 10);
+        ASSERT_EQ(nearest.size(), 10);
+        for (size_t i = 0; i < nearest.size(); ++i) {
+            EXPECT_EQ(SpatialIndex::distance(rects[nearest[i]], window), distances[i]);
+        }
+    }
+
+    EXPECT_TRUE(SpatialIndex().query(Rect{0, 0, 10, 10}).empty());
+}
+
+TEST(PageContextTest, ComputesIntermediatesOnce) {
+    auto image = std::make_shared<Image>();
+    image->path = "page.png";
+    image->width = 60;
+    image->height = 40;
+    image->mat.view = cv::Mat(40, 60, CV_8UC1, cv::Scalar(255));
+    PageContext context(image);
+
+    // edges() 基于 blurred()，不会重新计算或替换已经缓存的模糊图
+    const auto gray = context.gray().data;
+    const auto blurred = context.blurred().data;
+    ASSERT_NE(blurred, nullptr);
+    const auto edges = context.edges().data;
+    EXPECT_EQ(context.blurred().data, blurred);
+    EXPECT_EQ(context.gray().data, gray);
+    EXPECT_EQ(context.edges().data, edges);
+
+    int runs = 0;
+    const auto detect = [&](PageContext &) {
+        ++runs;
+        return Rects{{0, 10, 50, 10}};
+    };
+    const auto &first = context.segments("rle", detect);
+    const auto &second = context.segments("rle", detect);
+    EXPECT_EQ(runs, 1);
+    EXPECT_EQ(&first, &second);
+    context.segments("hough", detect);
+    EXPECT_EQ(runs, 2);
+
+    // 释放像素之后线段仍然可用
+    context.release_pixels();
+    EXPECT_EQ(context.segments("rle", detect).size(), 1);
+    EXPECT_EQ(runs, 2);
+}
+
+TEST(NormalizeTest, TransformMapsBoxesBack) {
+    Normalize::Transform transform{0.5, 0.0, 2000, 3000, 500, 750};
+    EXPECT_EQ(transform.to_original(Rect{100, 200, 150, 260}), (Rect{200, 400, 300, 520}));
+    EXPECT_EQ(transform.to_original(Rect{900, 1400, 1100, 1600}), (Rect{1800, 2800, 2000, 3000}));
+
+    // 按 pixRotate 的方向正向变换原图中的矩形，再映射回来，应当覆盖原矩形且只多出几个像素
+    transform.angle = 0.02;
+    const Rect original{600, 1000, 1400, 1100};
+    const auto cos_a = std::cos(transform.angle), sin_a = std::sin(transform.angle);
+    double x0 = 1e9, y0 = 1e9, x1 = -1e9, y1 = -1e9;
+    for (const auto x : {original.x0, original.x1}) {
+        for (const auto y : {original.y0, original.y1}) {
+            const auto dx = x * transform.scale - transform.center_x, dy = y * transform.scale - transform.center_y;
+            const auto nx = transform.center_x + dx * cos_a - dy * sin_a;
+            const auto ny = transform.center_y + dx * sin_a + dy * cos_a;
+            x0 = std::min(x0, nx), y0 = std::min(y0, ny), x1 = std::max(x1, nx), y1 = std::max(y1, ny);
+        }
+    }
+    const Rect normalized{int(std::floor(x0)), int(std::floor(y0)), int(std::ceil(x1)), int(std::ceil(y1))};
+    const auto mapped = transform.to_original(normalized);
+    EXPECT_TRUE(mapped.contains(original));
+    EXPECT_LE(mapped.width(), original.width() + 10);
+    EXPECT_LE(mapped.height(), original.height() + 2 * 800 * sin_a + 10);
+}
+
+TEST(TableTest, GridWithMergedCells) {
+    // 两行两列，第一行合并；坐标带有 1 像素的抖动，横线被切成两段
+    const Rectsf32 segments{
+        {0, 0, 200, 0}, {1, 49, 120, 49}, {118, 51, 200, 51}, {0, 100, 201, 100},
+        {0, 0, 0, 100}, {99, 50, 99, 100}, {200, 1, 200, 100},
+        {400, 400, 500, 400}, // 不相连的线不构成表格
+    };
+    const auto tables = table::Grid::build_all(segments);
+    ASSERT_EQ(tables.size(), 1);
+
+    const auto &table = tables.front();
+    EXPECT_EQ(table.rows(), 2);
+    EXPECT_EQ(table.cols(), 2);
+    EXPECT_EQ(table.bbox, (Rect{0, 0, 200, 100}));
+    ASSERT_EQ(table.cells.size(), 3);
+    EXPECT_EQ(std::tuple(table.cells[0].row, table.cells[0].col, table.cells[0].row_span, table.cells[0].col_span), std::tuple(0, 0, 1, 2));
+    EXPECT_EQ(std::tuple(table.cells[1].row, table.cells[1].col, table.cells[1].row_span, table.cells[1].col_span), std::tuple(1, 0, 1, 1));
+    EXPECT_EQ(std::tuple(table.cells[2].row, table.cells[2].col, table.cells[2].row_span, table.cells[2].col_span), std::tuple(1, 1, 1, 1));
+    EXPECT_EQ(table.cells[2].bbox, (Rect{99, 50, 200, 100}));
+}
+
+TEST(TableTest, JoinAssignsCharsInReadingOrder) {
+    // 第一行合并的两行两列表格，同上
+    const Rectsf32 segments{
+        {0, 0, 200, 0}, {0, 50, 200, 50}, {0, 100, 200, 100},
+        {0, 0, 0, 100}, {100, 50, 100, 100}, {200, 0, 200, 100},
+    };
+    auto tables = table::Grid::build_all(segments);
+    ASSERT_EQ(tables.size(), 1);
+    ASSERT_EQ(tables[0].cells.size(), 3);
+
+    fixed2_debugger::Page page;
+    page.append_char({10, 10, 150, 30}, {10, 10, 30, 30}, {10, 10, 20, 30}, "a", 20);
+    page.append_char({10, 10, 150, 30}, {10, 10, 30, 30}, {20, 10, 30, 30}, "b", 20);
+    page.append_char({10, 10, 150, 30}, {120, 10, 140, 30}, {120, 10, 140, 30}, "c", 20);
+    // 跨两个单元格的一行，两个词分别属于左右两格
+    page.append_char({10, 60, 140, 80}, {10, 60, 30, 80}, {10, 60, 30, 80}, "d", 20);
+    page.append_char({10, 60, 140, 80}, {120, 60, 140, 80}, {120, 60, 140, 80}, "e", 20);
+    page.append_char({10, 82, 30, 95}, {10, 82, 30, 95}, {10, 82, 30, 95}, "f", 20);
+    page.append_char({10, 300, 30, 320}, {10, 300, 30, 320}, {10, 300, 30, 320}, "z", 20);
+
+    table::Join::run(tables, page);
+    const auto &cells = tables[0].cells;
+    EXPECT_EQ(cells[0].text, "ab c");
+    EXPECT_EQ(cells[1].text, "d\nf");
+    EXPECT_EQ(cells[2].text, "e");
+    EXPECT_EQ(cells[0].words, (std::vector<uint32_t>{0, 1}));
+    EXPECT_EQ(cells[1].chars, (std::vector<uint32_t>{3, 5}));
+    EXPECT_EQ(tables[0].cell_at(15, 310), -1);
+}
+
+TEST(FlatHashTest, MatchesUnorderedMap) {
+    std::mt19937 rng(1);
+    FlatHashMap<int, int> flat;
+    std::unordered_map<int, int> expected;
+    for (int i = 0; i < 100000; ++i) {
+        const int key = rng() % 3000;
+        switch (rng() % 3) {
+        case 0:
+            flat[key] = i;
+            expected[key] = i;
+            break;
+        case 1:
+            ASSERT_EQ(flat.erase(key), expected.erase(key));
+            break;
+        default:
+            const auto it = flat.find(key);
+            const auto jt = expected.find(key);
+            ASSERT_EQ(it == flat.end(), jt == expected.end());
+            if (jt != expected.end()) {
+                EXPECT_EQ(it->second, jt->second);
+            }
+        }
+    }
+    EXPECT_EQ(flat.size(), expected.size());
+}
+
+TEST(FlatHashTest, RectHashSeparatesGridBoxes) {
+    // 同尺寸、按网格平移的字符框，异或哈希只会得到很少几个不同的值
+    std::unordered_set<size_t> hashes;
+    FlatHashSet<Rect> boxes;
+    for (int line = 0; line < 50; ++line) {
+        for (int col = 0; col < 50; ++col) {
+            const Rect box{col * 24, line * 32, col * 24 + 20, line * 32 + 24};
+            hashes.insert(std::hash<Rect>()(box));
+            EXPECT_TRUE(boxes.insert(box).second);
+        }
+    }
+    EXPECT_EQ(hashes.size(), 2500);
+    EXPECT_FALSE(boxes.insert(Rect{0, 0, 20, 24}).second);
+    EXPECT_TRUE(boxes.contains(Rect{24, 32, 44, 56}));
+    EXPECT_FALSE(boxes.contains(Rect{24, 32, 44, 57}));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -4,15 +4,17 @@
 #include <string>
 
 #include <stdio.h>
+
+#include "engine_pool.h"
+
 #include <tesseract/baseapi.h>
 #include <leptonica/allheaders.h>
 
 static int ocr(const std::string &image_path, const std::string &tessdata, const std::string &lang)
 {
-    auto api = std::make_shared<tesseract::TessBaseAPI>();
-    if (api->Init(tessdata.c_str(), lang.c_str()))
+    auto api = EnginePool::instance().acquire(EngineKey{tessdata, lang});
+    if (!api)
     {
-        fprintf(stderr, "Could not initialize tesseract.\n");
         return -1;
     }
     auto image = std::shared_ptr<Pix>(